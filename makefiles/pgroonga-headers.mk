@@ -17,6 +17,7 @@ HEADERS =					\
 	src/pgrn-groonga-tuple-is-alive.h	\
 	src/pgrn-groonga.h			\
 	src/pgrn-highlight-html.h		\
+	src/pgrn-index-cache.h			\
 	src/pgrn-index-status.h			\
 	src/pgrn-jsonb.h			\
 	src/pgrn-log-level.h			\
@@ -38,6 +39,7 @@ HEADERS =					\
 	src/pgrn-trace-log.h			\
 	src/pgrn-value.h			\
 	src/pgrn-variables.h			\
+	src/pgrn-wal-applier-statuses.h		\
 	src/pgrn-wal.h				\
 	src/pgrn-writable.h			\
 	src/pgroonga.h
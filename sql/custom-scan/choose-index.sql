@@ -0,0 +1,44 @@
+CREATE TABLE memos (
+  id integer,
+  title text,
+  content text
+);
+
+CREATE INDEX title_index ON memos USING pgroonga (title);
+CREATE INDEX title_content_index ON memos USING pgroonga (title, content);
+
+INSERT INTO memos VALUES (1, 'PostgreSQL', 'PostgreSQL is a RDBMS.');
+INSERT INTO memos VALUES (2, 'Groonga', 'Groonga is fast full text search engine.');
+INSERT INTO memos VALUES (3, 'PGroonga', 'PGroonga is a PostgreSQL extension that uses Groonga.');
+
+SET enable_seqscan = off;
+SET pgroonga.enable_custom_scan = on;
+
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT id, title
+  FROM memos
+ WHERE title &@~ 'PGroonga OR Groonga';
+
+SELECT id, title
+  FROM memos
+ WHERE title &@~ 'PGroonga OR Groonga'
+ ORDER BY id;
+
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT id, title
+  FROM memos
+ WHERE title &@~ 'PGroonga OR Groonga' AND
+       content &@~ 'PostgreSQL';
+
+SELECT id, title
+  FROM memos
+ WHERE title &@~ 'PGroonga OR Groonga' AND
+       content &@~ 'PostgreSQL';
+
+SELECT id, title
+  FROM memos
+ WHERE title &@~ 'PGroonga OR Groonga' AND
+       id < 3
+ ORDER BY id;
+
+DROP TABLE memos;
@@ -12,6 +12,7 @@ UPDATE memos
    SET content = 'PGroonga is a PostgreSQL extension that uses Groonga!!!'
  WHERE id = 3;
 
+SET enable_seqscan = off;
 SET pgroonga.enable_custom_scan = on;
 
 EXPLAIN (COSTS OFF)
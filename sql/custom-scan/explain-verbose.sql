@@ -0,0 +1,20 @@
+CREATE TABLE memos (
+  id integer,
+  content text
+);
+
+CREATE INDEX memos_content_index ON memos USING pgroonga (content);
+
+INSERT INTO memos VALUES (1, 'PostgreSQL is a RDBMS.');
+INSERT INTO memos VALUES (2, 'Groonga is fast full text search engine.');
+INSERT INTO memos VALUES (3, 'PGroonga is a PostgreSQL extension that uses Groonga.');
+
+SET enable_seqscan = off;
+SET pgroonga.enable_custom_scan = on;
+
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT id, content
+  FROM memos
+ WHERE content &@~ 'Groonga';
+
+DROP TABLE memos;
@@ -0,0 +1,28 @@
+CREATE TABLE memos (
+  id integer,
+  content text
+);
+
+CREATE INDEX grnindex ON memos USING pgroonga (id, content);
+
+INSERT INTO memos VALUES (1, 'PostgreSQL is a RDBMS.');
+INSERT INTO memos VALUES (2, 'Groonga is fast full text search engine.');
+INSERT INTO memos VALUES (3, 'PGroonga is a PostgreSQL extension that uses Groonga.');
+
+SET enable_seqscan = off;
+SET enable_indexscan = off;
+SET enable_bitmapscan = off;
+SET pgroonga.enable_custom_scan = on;
+
+EXPLAIN (COSTS OFF)
+SELECT id, upper(content)
+  FROM memos
+ WHERE content &@~ 'Groonga'
+ ORDER BY id;
+
+SELECT id, upper(content)
+  FROM memos
+ WHERE content &@~ 'Groonga'
+ ORDER BY id;
+
+DROP TABLE memos;
@@ -0,0 +1,50 @@
+CREATE TABLE memos (
+  id integer,
+  content text,
+  padding text
+) WITH (fillfactor = 10);
+
+CREATE INDEX grnindex ON memos USING pgroonga (id, content);
+
+-- Each row is stored in its own page.
+INSERT INTO memos VALUES (1, 'PostgreSQL is a RDBMS.', repeat('-', 1000));
+INSERT INTO memos VALUES (2, 'Groonga is fast full text search engine.', repeat('-', 1000));
+INSERT INTO memos VALUES (3, 'PGroonga is a PostgreSQL extension that uses Groonga.', repeat('-', 1000));
+
+VACUUM memos;
+
+SET enable_seqscan = off;
+SET pgroonga.enable_custom_scan = on;
+
+\pset format unaligned
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+SELECT id, content
+  FROM memos
+ WHERE content &@~ 'PGroonga OR Groonga'
+ ORDER BY id
+\g |grep -o -E "(Visibility Checks|Heap Fetches|Dead Hits): [0-9]+"
+\pset format aligned
+
+SELECT id, content
+  FROM memos
+ WHERE content &@~ 'PGroonga OR Groonga'
+ ORDER BY id;
+
+-- The page of the deleted row isn't all-visible.
+DELETE FROM memos WHERE id = 2;
+
+\pset format unaligned
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+SELECT id, content
+  FROM memos
+ WHERE content &@~ 'PGroonga OR Groonga'
+ ORDER BY id
+\g |grep -o -E "(Visibility Checks|Heap Fetches|Dead Hits): [0-9]+"
+\pset format aligned
+
+SELECT id, content
+  FROM memos
+ WHERE content &@~ 'PGroonga OR Groonga'
+ ORDER BY id;
+
+DROP TABLE memos;
@@ -0,0 +1,31 @@
+CREATE TABLE memos (
+  id integer,
+  content text
+);
+
+CREATE INDEX grnindex ON memos USING pgroonga (id, content);
+
+INSERT INTO memos VALUES (1, 'Groonga is fast.');
+INSERT INTO memos VALUES (2, 'PGroonga uses Groonga.');
+INSERT INTO memos VALUES (3, 'Groonga is a full text search engine.');
+INSERT INTO memos VALUES (4, 'Mroonga uses Groonga.');
+INSERT INTO memos VALUES (5, 'Rroonga uses Groonga.');
+DELETE FROM memos WHERE id = 4;
+
+SET enable_seqscan = off;
+SET pgroonga.enable_custom_scan = on;
+
+EXPLAIN (COSTS OFF)
+SELECT id, content
+  FROM memos
+ WHERE content &@~ 'Groonga'
+ ORDER BY id DESC
+ LIMIT 2 OFFSET 1;
+
+SELECT id, content
+  FROM memos
+ WHERE content &@~ 'Groonga'
+ ORDER BY id DESC
+ LIMIT 2 OFFSET 1;
+
+DROP TABLE memos;
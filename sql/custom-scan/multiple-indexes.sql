@@ -11,6 +11,7 @@ INSERT INTO memos VALUES (1, 'pgsql', 'PostgreSQL is a RDBMS.');
 INSERT INTO memos VALUES (2, 'groonga', 'Groonga is fast full text search engine.');
 INSERT INTO memos VALUES (3, 'pgroonga', 'PGroonga is a PostgreSQL extension that uses Groonga.');
 
+SET enable_seqscan = off;
 SET pgroonga.enable_custom_scan = on;
 
 EXPLAIN (COSTS OFF)
@@ -0,0 +1,57 @@
+CREATE TABLE memos (
+  id integer,
+  content text
+);
+
+CREATE INDEX grnindex ON memos USING pgroonga (id, content);
+
+INSERT INTO memos VALUES (1, 'PostgreSQL is a RDBMS.');
+INSERT INTO memos VALUES (2, 'Groonga is fast full text search engine.');
+INSERT INTO memos VALUES (3, 'PGroonga is a PostgreSQL extension that uses Groonga.');
+
+CREATE TABLE searches (
+  id integer PRIMARY KEY,
+  query text
+);
+
+INSERT INTO searches VALUES (1, 'PostgreSQL');
+INSERT INTO searches VALUES (2, 'Mroonga');
+INSERT INTO searches VALUES (3, NULL);
+INSERT INTO searches VALUES (4, 'Groonga');
+
+SET enable_seqscan = off;
+SET enable_incremental_sort = off;
+SET pgroonga.enable_custom_scan = on;
+
+EXPLAIN (COSTS OFF)
+SELECT searches.query, hits.id
+  FROM searches,
+       LATERAL (SELECT id
+                  FROM memos
+                 WHERE content &@~ searches.query
+                 ORDER BY id
+                 LIMIT 1) AS hits
+ ORDER BY searches.id;
+
+SELECT searches.query, hits.id
+  FROM searches,
+       LATERAL (SELECT id
+                  FROM memos
+                 WHERE content &@~ searches.query
+                 ORDER BY id
+                 LIMIT 1) AS hits
+ ORDER BY searches.id;
+
+EXPLAIN (COSTS OFF)
+SELECT searches.query, memos.id
+  FROM searches
+       JOIN memos ON memos.content &@~ searches.query
+ ORDER BY searches.id, memos.id;
+
+SELECT searches.query, memos.id
+  FROM searches
+       JOIN memos ON memos.content &@~ searches.query
+ ORDER BY searches.id, memos.id;
+
+DROP TABLE searches;
+DROP TABLE memos;
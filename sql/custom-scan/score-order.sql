@@ -0,0 +1,31 @@
+CREATE TABLE memos (
+  id integer,
+  content text
+);
+
+CREATE INDEX memos_content_index ON memos USING pgroonga (content);
+
+INSERT INTO memos VALUES (1, 'PostgreSQL is a RDBMS.');
+INSERT INTO memos VALUES (2, 'Groonga is fast full text search engine.');
+INSERT INTO memos VALUES (3, 'PGroonga is a PostgreSQL extension that uses Groonga.');
+INSERT INTO memos VALUES (4, 'PGroonga uses Groonga.');
+
+SET enable_seqscan = off;
+SET enable_indexscan = off;
+SET enable_bitmapscan = off;
+SET pgroonga.enable_custom_scan = on;
+
+EXPLAIN (COSTS OFF)
+SELECT id, content, pgroonga_score(tableoid, ctid)
+  FROM memos
+ WHERE content &@~ 'PGroonga OR Groonga OR PostgreSQL'
+ ORDER BY pgroonga_score(tableoid, ctid) DESC
+ LIMIT 2;
+
+SELECT id, content, pgroonga_score(tableoid, ctid)
+  FROM memos
+ WHERE content &@~ 'PGroonga OR Groonga OR PostgreSQL'
+ ORDER BY pgroonga_score(tableoid, ctid) DESC
+ LIMIT 2;
+
+DROP TABLE memos;
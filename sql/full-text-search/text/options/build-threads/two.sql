@@ -0,0 +1,19 @@
+CREATE TABLE memos (
+  content text
+);
+
+INSERT INTO memos VALUES ('PostgreSQL is a RDBMS.');
+INSERT INTO memos VALUES ('Groonga is fast full text search engine.');
+INSERT INTO memos VALUES ('PGroonga is a PostgreSQL extension that uses Groonga.');
+
+CREATE INDEX pgrn_index ON memos
+  USING pgroonga (content)
+  WITH (build_threads = 2);
+
+SET enable_seqscan = off;
+
+SELECT *
+  FROM memos
+ WHERE content &@ 'Groonga';
+
+DROP TABLE memos;
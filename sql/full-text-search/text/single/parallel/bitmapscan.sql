@@ -0,0 +1,43 @@
+CREATE TABLE memos (
+  id integer,
+  content text
+);
+
+INSERT INTO memos
+  SELECT id,
+         CASE WHEN id % 3 = 0
+           THEN 'Groonga is fast: ' || id
+           ELSE 'PostgreSQL is a RDBMS: ' || id
+         END
+    FROM generate_series(1, 10000) AS id;
+
+CREATE INDEX memos_content_index ON memos USING pgroonga (content);
+
+ALTER TABLE memos SET (parallel_workers = 2);
+
+SET enable_seqscan = off;
+SET enable_indexscan = off;
+SET enable_bitmapscan = on;
+
+SET max_parallel_workers_per_gather = 0;
+
+SELECT count(id), sum(id)
+  FROM memos
+ WHERE content &@~ 'Groonga';
+
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_index_scan_size = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+
+EXPLAIN (COSTS OFF)
+SELECT count(id), sum(id)
+  FROM memos
+ WHERE content &@~ 'Groonga';
+
+SELECT count(id), sum(id)
+  FROM memos
+ WHERE content &@~ 'Groonga';
+
+DROP TABLE memos;
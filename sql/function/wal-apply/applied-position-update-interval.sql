@@ -0,0 +1,42 @@
+SET pgroonga.enable_wal = yes;
+SET pgroonga.wal_applied_position_update_interval = 2;
+
+CREATE TABLE memos (
+  content text
+);
+
+INSERT INTO memos VALUES ('Groonga is fast!');
+
+CREATE INDEX pgrn_index ON memos USING PGroonga (content);
+
+INSERT INTO memos VALUES ('PGroonga is also fast!');
+
+SELECT pgroonga_wal_set_applied_position('pgrn_index', 0, 0);
+SELECT pgroonga_command('table_remove',
+                        ARRAY[
+                          'name', 'Lexicon' ||
+                                  'pgrn_index'::regclass::oid ||
+                                  '_0'
+                        ])::jsonb->>1;
+SELECT pgroonga_command('table_remove',
+                        ARRAY[
+                          'name', pgroonga_table_name('pgrn_index')
+                        ])::jsonb->>1;
+
+SELECT pgroonga_wal_apply('pgrn_index');
+
+SELECT pgroonga_command('select',
+                        ARRAY[
+                          'table', pgroonga_table_name('pgrn_index'),
+                          'output_columns', '_id, content'
+                        ])::jsonb->>1;
+
+SELECT current_block = last_block AND
+       current_offset = last_offset AS applied_all
+  FROM pgroonga_wal_status()
+ WHERE name = 'pgrn_index';
+
+DROP TABLE memos;
+
+SET pgroonga.wal_applied_position_update_interval = default;
+SET pgroonga.enable_wal = default;
@@ -9,7 +9,7 @@ SELECT clock_timestamp()::text
   FROM generate_series(1, 50000);
 
 CREATE INDEX pgrn_memos_index ON memos USING PGroonga (content);
-SELECT pgroonga_wal_truncate();
+SELECT pgroonga_wal_truncate() BETWEEN 300 AND 400;
 
 DROP TABLE memos;
 
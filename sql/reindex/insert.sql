@@ -0,0 +1,34 @@
+CREATE TABLE memos (
+  id integer,
+  content text
+);
+
+CREATE INDEX pgrn_index ON memos USING pgroonga (content);
+
+INSERT INTO memos VALUES (1, 'PostgreSQL is a RDBMS.');
+INSERT INTO memos VALUES (2, 'Groonga is fast full text search engine.');
+
+REINDEX INDEX pgrn_index;
+
+INSERT INTO memos VALUES (3, 'PGroonga is a PostgreSQL extension that uses Groonga.');
+
+SET enable_seqscan = off;
+SET enable_indexscan = on;
+SET enable_bitmapscan = off;
+
+SELECT id, content
+  FROM memos
+ WHERE content &@~ 'Groonga'
+ ORDER BY id;
+
+DROP INDEX pgrn_index;
+CREATE INDEX pgrn_index ON memos USING pgroonga (content);
+
+INSERT INTO memos VALUES (4, 'Mroonga is a MySQL storage engine that uses Groonga.');
+
+SELECT id, content
+  FROM memos
+ WHERE content &@~ 'Groonga'
+ ORDER BY id;
+
+DROP TABLE memos;
@@ -0,0 +1,8 @@
+-- To load PGroonga
+SELECT pgroonga_command('status')::json->0->0;
+
+SHOW pgroonga.build_threads;
+SET pgroonga.build_threads = 4;
+SHOW pgroonga.build_threads;
+SET pgroonga.build_threads = default;
+SHOW pgroonga.build_threads;
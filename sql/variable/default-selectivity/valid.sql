@@ -0,0 +1,8 @@
+-- To load PGroonga
+SELECT pgroonga_command('status')::json->0->0;
+
+SHOW pgroonga.default_selectivity;
+SET pgroonga.default_selectivity = 0.1;
+SHOW pgroonga.default_selectivity;
+SET pgroonga.default_selectivity = default;
+SHOW pgroonga.default_selectivity;
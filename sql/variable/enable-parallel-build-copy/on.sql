@@ -0,0 +1,33 @@
+CREATE TABLE tags (
+  name text,
+  names text[]
+);
+
+INSERT INTO tags
+  SELECT 'PGroonga' || (i % 10),
+         ARRAY['PGroonga' || (i % 10), 'Groonga' || (i % 7)]
+    FROM generate_series(1, 1000) AS i;
+
+ALTER TABLE tags SET (parallel_workers = 2);
+
+SET pgroonga.enable_parallel_build_copy = on;
+SET max_parallel_maintenance_workers = 2;
+
+CREATE INDEX pgrn_name_index ON tags
+  USING pgroonga (name pgroonga_text_term_search_ops_v2);
+CREATE INDEX pgrn_names_index ON tags
+  USING pgroonga (names pgroonga_text_array_term_search_ops_v2);
+
+SET enable_seqscan = off;
+SET enable_indexscan = off;
+SET enable_bitmapscan = on;
+
+SELECT count(*)
+  FROM tags
+ WHERE name &^ 'pgroonga1';
+
+SELECT count(*)
+  FROM tags
+ WHERE names &^ 'groonga3';
+
+DROP TABLE tags;
@@ -0,0 +1,8 @@
+-- To load PGroonga
+SELECT pgroonga_command('status')::json->0->0;
+
+SHOW pgroonga.posting_cost;
+SET pgroonga.posting_cost = 0.01;
+SHOW pgroonga.posting_cost;
+SET pgroonga.posting_cost = default;
+SHOW pgroonga.posting_cost;
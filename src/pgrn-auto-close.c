@@ -3,6 +3,8 @@
 #include "pgrn-auto-close.h"
 #include "pgrn-compatible.h"
 #include "pgrn-global.h"
+#include "pgrn-groonga.h"
+#include "pgrn-index-cache.h"
 
 static grn_hash *usingIndexes = NULL;
 
@@ -25,58 +27,30 @@ PGrnFinalizeAutoClose(void)
 static void
 PGrnAutoCloseCloseUnusedObjects(Oid nodeID)
 {
-	char *prefixes[] = {
-		PGrnLexiconNamePrefix "%u_",
-		PGrnJSONValueLexiconNamePrefix "FullTextSearch%u_",
-		PGrnJSONValueLexiconNamePrefix "String%u_",
-		PGrnJSONValueLexiconNamePrefix "Number%u_",
-		PGrnJSONValueLexiconNamePrefix "Boolean%u_",
-		PGrnJSONValueLexiconNamePrefix "Size%u_",
-		PGrnJSONTypesTableNamePrefix "%u_",
-		PGrnJSONValuesTableNamePrefix "%u_",
-		PGrnJSONPathsTableNamePrefix "%u_",
-		PGrnBuildingSourcesTableNamePrefix "%u",
-		PGrnSourcesTableNamePrefix "%u",
-	};
+	grn_obj ids;
 	size_t i;
-	const size_t n_prefixes = sizeof(prefixes) / sizeof(*prefixes);
-	grn_obj *db;
+	size_t nIDs;
 
-	db = grn_ctx_db(ctx);
-	for (i = 0; i < n_prefixes; i++)
+	PGrnIndexCacheInvalidate();
+	GRN_RECORD_INIT(&ids, GRN_OBJ_VECTOR, GRN_ID_NIL);
+	PGrnCollectIndexObjectIDs(nodeID, &ids);
+	nIDs = GRN_BULK_VSIZE(&ids) / sizeof(grn_id);
+	for (i = 0; i < nIDs; i++)
 	{
-		char prefix[GRN_TABLE_MAX_KEY_SIZE];
+		grn_id id = GRN_RECORD_VALUE_AT(&ids, i);
+		grn_obj *object;
 
-		snprintf(prefix, sizeof(prefix), prefixes[i], nodeID);
-		GRN_TABLE_EACH_BEGIN_MIN(ctx,
-								 db,
-								 cursor,
-								 id,
-								 prefix,
-								 strlen(prefix),
-								 GRN_CURSOR_PREFIX | GRN_CURSOR_DESCENDING)
-		{
-			void *key;
-			const char *name;
-			int name_size;
-			grn_obj *object;
+		if (!grn_ctx_is_opened(ctx, id))
+			continue;
 
-			if (!grn_ctx_is_opened(ctx, id))
-				continue;
-
-			name_size = grn_table_cursor_get_key(ctx, cursor, &key);
-			name = key;
-			GRN_LOG(ctx,
-					GRN_LOG_DEBUG,
-					"pgroonga: auto-close: <%.*s>",
-					name_size,
-					name);
-
-			object = grn_ctx_at(ctx, id);
-			grn_obj_close(ctx, object);
-		}
-		GRN_TABLE_EACH_END(ctx, cursor);
+		object = grn_ctx_at(ctx, id);
+		GRN_LOG(ctx,
+				GRN_LOG_DEBUG,
+				"pgroonga: auto-close: <%s>",
+				PGrnInspectName(object));
+		grn_obj_close(ctx, object);
 	}
+	GRN_OBJ_FIN(ctx, &ids);
 }
 
 void
@@ -33,6 +33,7 @@
 
 #if PG_VERSION_NUM >= 170000
 #	define PGRN_SUPPORT_PARALLEL_INDEX_BUILD
+#	define PGRN_SUPPORT_AM_INSERT_CLEANUP
 #endif
 
 #if PG_VERSION_NUM >= 180000
@@ -168,3 +169,19 @@ pgrn_get_opfamily_name(Oid opfid, bool missing_ok)
 	return opfname;
 }
 #endif
+
+#if PG_VERSION_NUM >= 140000
+#	define pgrn_pull_varnos(root, node) pull_varnos((root), (node))
+#else
+#	define pgrn_pull_varnos(root, node) pull_varnos((node))
+#endif
+
+#if PG_VERSION_NUM >= 160000
+#	define pgrn_adjust_appendrel_attrs_multilevel(root, node, childRel)       \
+		adjust_appendrel_attrs_multilevel(                                     \
+			(root), (node), (childRel), (childRel)->top_parent)
+#else
+#	define pgrn_adjust_appendrel_attrs_multilevel(root, node, childRel)       \
+		adjust_appendrel_attrs_multilevel(                                     \
+			(root), (node), (childRel)->relids, (childRel)->top_parent_relids)
+#endif
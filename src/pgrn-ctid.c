@@ -4,6 +4,7 @@
 
 #include <access/heapam.h>
 #include <access/htup.h>
+#include <access/visibilitymap.h>
 #include <storage/buf.h>
 #include <storage/bufmgr.h>
 #include <utils/snapmgr.h>
@@ -29,6 +30,145 @@ PGrnCtidIsAlive(Relation table, ItemPointer ctid)
 	return found;
 }
 
+void
+PGrnCtidCheckerInit(PGrnCtidChecker *checker,
+					Relation table,
+					Snapshot snapshot,
+					bool useVisibilityMap)
+{
+	checker->table = table;
+	checker->snapshot = snapshot;
+	checker->useVisibilityMap = useVisibilityMap;
+	checker->visibilityMapBuffer = InvalidBuffer;
+	checker->memoryContext = CurrentMemoryContext;
+	checker->order = NULL;
+	checker->orderSize = 0;
+}
+
+void
+PGrnCtidCheckerFin(PGrnCtidChecker *checker)
+{
+	if (BufferIsValid(checker->visibilityMapBuffer))
+	{
+		ReleaseBuffer(checker->visibilityMapBuffer);
+		checker->visibilityMapBuffer = InvalidBuffer;
+	}
+	if (checker->order)
+	{
+		pfree(checker->order);
+		checker->order = NULL;
+	}
+	checker->orderSize = 0;
+}
+
+static int
+PGrnCtidCheckerCompare(const void *a, const void *b, void *arg)
+{
+	ItemPointerData *ctids = arg;
+	return ItemPointerCompare(&(ctids[*((const uint32 *) a)]),
+							  &(ctids[*((const uint32 *) b)]));
+}
+
+/*
+ * Sets alives[i] to whether ctids[i] is visible or not. Each ctid is
+ * updated to the visible HOT chain member like PGrnCtidIsAlive().
+ *
+ * If tuples isn't NULL, tuples[i] is set to a copy of the visible heap
+ * tuple while its page is pinned. It's allocated in the current memory
+ * context. tuples[i] is NULL when ctids[i] isn't visible. Don't use
+ * the visibility map with tuples because all-visible pages aren't
+ * read.
+ *
+ * This returns the number of ctids that are checked by reading heap
+ * pages. Other ctids are on all-visible pages.
+ */
+uint32
+PGrnCtidCheckerCheck(PGrnCtidChecker *checker,
+					 ItemPointerData *ctids,
+					 bool *alives,
+					 HeapTuple *tuples,
+					 uint32 n)
+{
+	Buffer buffer = InvalidBuffer;
+	BlockNumber currentBlockNumber = InvalidBlockNumber;
+	bool currentAllVisible = false;
+	uint32 nHeapFetches = 0;
+	uint32 i;
+
+	if (n == 0)
+		return 0;
+
+	if (checker->orderSize < n)
+	{
+		if (checker->order)
+			pfree(checker->order);
+		checker->order =
+			MemoryContextAlloc(checker->memoryContext, sizeof(uint32) * n);
+		checker->orderSize = n;
+	}
+	for (i = 0; i < n; i++)
+	{
+		checker->order[i] = i;
+	}
+	qsort_arg(
+		checker->order, n, sizeof(uint32), PGrnCtidCheckerCompare, ctids);
+
+	for (i = 0; i < n; i++)
+	{
+		uint32 index = checker->order[i];
+		ItemPointer ctid = &(ctids[index]);
+		BlockNumber blockNumber = ItemPointerGetBlockNumber(ctid);
+		HeapTupleData heapTuple;
+
+		if (blockNumber != currentBlockNumber)
+		{
+			if (BufferIsValid(buffer))
+			{
+				LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+				ReleaseBuffer(buffer);
+				buffer = InvalidBuffer;
+			}
+			currentBlockNumber = blockNumber;
+			currentAllVisible =
+				checker->useVisibilityMap &&
+				VM_ALL_VISIBLE(checker->table,
+							   blockNumber,
+							   &(checker->visibilityMapBuffer));
+			if (!currentAllVisible)
+			{
+				buffer = ReadBuffer(checker->table, blockNumber);
+				LockBuffer(buffer, BUFFER_LOCK_SHARE);
+			}
+		}
+
+		if (currentAllVisible)
+		{
+			alives[index] = true;
+			if (tuples)
+				tuples[index] = NULL;
+			continue;
+		}
+
+		nHeapFetches++;
+		alives[index] = heap_hot_search_buffer(ctid,
+											   checker->table,
+											   buffer,
+											   checker->snapshot,
+											   &heapTuple,
+											   NULL,
+											   true);
+		if (tuples)
+			tuples[index] = alives[index] ? heap_copytuple(&heapTuple) : NULL;
+	}
+	if (BufferIsValid(buffer))
+	{
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		ReleaseBuffer(buffer);
+	}
+
+	return nHeapFetches;
+}
+
 uint64_t
 PGrnCtidPack(ItemPointer ctid)
 {
@@ -3,9 +3,41 @@
 #include <stdint.h>
 
 #include <postgres.h>
+#include <access/htup.h>
+#include <storage/buf.h>
 #include <storage/itemptr.h>
 #include <utils/relcache.h>
+#include <utils/snapshot.h>
+
+/*
+ * Checks visibility of many ctids at once. Ctids are checked in heap
+ * order and each heap page is read only once per check.
+ */
+typedef struct PGrnCtidChecker
+{
+	Relation table;
+	Snapshot snapshot;
+	/* Uses the visibility map to skip reading all-visible heap pages.
+	 * Ctids aren't resolved to the latest HOT chain members for
+	 * all-visible pages. So this should be used only when heap tuples
+	 * aren't needed. */
+	bool useVisibilityMap;
+	Buffer visibilityMapBuffer;
+	MemoryContext memoryContext;
+	uint32 *order;
+	uint32 orderSize;
+} PGrnCtidChecker;
 
 bool PGrnCtidIsAlive(Relation table, ItemPointer ctid);
+void PGrnCtidCheckerInit(PGrnCtidChecker *checker,
+						 Relation table,
+						 Snapshot snapshot,
+						 bool useVisibilityMap);
+void PGrnCtidCheckerFin(PGrnCtidChecker *checker);
+uint32 PGrnCtidCheckerCheck(PGrnCtidChecker *checker,
+							ItemPointerData *ctids,
+							bool *alives,
+							HeapTuple *tuples,
+							uint32 n);
 uint64_t PGrnCtidPack(ItemPointer ctid);
 ItemPointerData PGrnCtidUnpack(uint64_t packedCtid);
@@ -4,39 +4,184 @@
 #	include <commands/explain_format.h>
 #endif
 #include <access/heapam.h>
+#include <access/parallel.h>
 #include <catalog/index.h>
 #include <executor/executor.h>
 #include <nodes/extensible.h>
 #include <nodes/nodeFuncs.h>
+#include <optimizer/appendinfo.h>
+#include <optimizer/cost.h>
 #include <optimizer/optimizer.h>
 #include <optimizer/pathnode.h>
 #include <optimizer/paths.h>
+#include <optimizer/planmain.h>
 #include <optimizer/restrictinfo.h>
+#include <pgstat.h>
+#include <port/atomics.h>
+#include <portability/instr_time.h>
 #include <storage/bufmgr.h>
+#include <storage/condition_variable.h>
+#include <storage/spin.h>
+#include <utils/dsa.h>
 #include <utils/lsyscache.h>
-#include <utils/snapmgr.h>
+
+#include <math.h>
 
 #include "pgroonga.h"
 
 #include "pgrn-ctid.h"
 #include "pgrn-custom-scan.h"
+#include "pgrn-global.h"
 #include "pgrn-groonga.h"
 #include "pgrn-search.h"
 
+/*
+ * The number of records that a parallel custom scan participant claims
+ * at once from the shared search result.
+ */
+#define PGRN_SCAN_PARALLEL_CHUNK_SIZE 1024
+
+/*
+ * Records are read from the cursor and their ctids are checked by
+ * batch. The batch size starts small for LIMIT and grows to the max
+ * size.
+ */
+#define PGRN_SCAN_BATCH_MIN_SIZE 16
+#define PGRN_SCAN_BATCH_MAX_SIZE 1024
+
+typedef struct PGrnScanParallelRecord
+{
+	grn_id id;
+	double score;
+} PGrnScanParallelRecord;
+
+/*
+ * The max size of Groonga Expression in EXPLAIN ANALYZE for parallel
+ * custom scan. A longer expression is truncated.
+ */
+#define PGRN_SCAN_PARALLEL_EXPRESSION_SIZE 1024
+
+/*
+ * Statistics of parallel workers for EXPLAIN ANALYZE. Each worker adds
+ * its statistics in PGrnShutdownCustomScan(). The leader merges them
+ * into its statistics. Statistics of workers that are still running
+ * when the leader is shut down such as with LIMIT aren't included.
+ */
+typedef struct PGrnScanParallelStatistics
+{
+	char expression[PGRN_SCAN_PARALLEL_EXPRESSION_SIZE];
+	uint64 nEstimatedHits;
+	uint64 nHits;
+	instr_time selectTime;
+	instr_time sortTime;
+	uint64 nVisibilityChecks;
+	uint64 nHeapFetches;
+	uint64 nDeadHits;
+	bool matchEscalated;
+} PGrnScanParallelStatistics;
+
+/*
+ * This is placed in the DSM of the parallel query. The first
+ * participant searches and publishes the result as an array of
+ * PGrnScanParallelRecord in the DSA of the parallel query because the
+ * result size isn't known when the DSM of the parallel query is
+ * estimated. The array is alive until the parallel query is finished
+ * or rescanned. All participants claim records from the array by
+ * chunk.
+ */
+typedef struct PGrnScanParallelSharedData
+{
+	slock_t mutex;
+	bool searching;
+	bool published;
+	dsa_pointer records;
+	uint64 nRecords;
+	pg_atomic_uint64 nextPosition;
+	ConditionVariable conditionVariable;
+	PGrnScanParallelStatistics statistics;
+} PGrnScanParallelSharedData;
+
+typedef enum
+{
+	PGRN_SCAN_TARGET_UNSUPPORTED,
+	PGRN_SCAN_TARGET_INDEX_COLUMN,
+	PGRN_SCAN_TARGET_HEAP_COLUMN,
+	PGRN_SCAN_TARGET_SCORE,
+	PGRN_SCAN_TARGET_EXPRESSION,
+} PGrnScanTargetType;
+
+/*
+ * How to compute a target list entry. This is prepared once in
+ * PGrnBeginCustomScan() not for each tuple.
+ */
+typedef struct PGrnScanTarget
+{
+	PGrnScanTargetType type;
+	Oid typeID;
+	AttrNumber attributeNumber;
+	const char *columnName;
+	/* For PGRN_SCAN_TARGET_INDEX_COLUMN. */
+	grn_obj *column;
+	/* For PGRN_SCAN_TARGET_EXPRESSION. */
+	ExprState *exprState;
+} PGrnScanTarget;
+
+/*
+ * Statistics for EXPLAIN ANALYZE. They are accumulated over rescans.
+ * For parallel custom scan, the leader merges statistics of workers.
+ */
+typedef struct PGrnScanStatistics
+{
+	/* Whether the costly ones such as expression and estimated hits
+	 * are collected. */
+	bool enabled;
+	grn_obj expression;
+	uint64 nEstimatedHits;
+	uint64 nHits;
+	instr_time selectTime;
+	instr_time sortTime;
+	uint64 nVisibilityChecks;
+	/* Visibility checks that read heap pages. Others use the
+	 * visibility map. */
+	uint64 nHeapFetches;
+	uint64 nDeadHits;
+	bool matchEscalated;
+} PGrnScanStatistics;
+
 typedef struct PGrnScanState
 {
 	CustomScanState parent; /* must be first field */
 	Oid indexOID;
 	List *scanKeySources;
 	List *pathKeys;
+	int limit;
+	int nSortedRecords;
 	grn_table_cursor *tableCursor;
-	grn_obj columns;
+	PGrnScanTarget *targets;
+	int nTargets;
+	/* For PGRN_SCAN_TARGET_HEAP_COLUMN. NULL if it's not needed. */
+	TupleTableSlot *heapSlot;
 	grn_obj columnValue;
 	PGrnSearchData searchData;
 	grn_obj *searched;
 	grn_obj *sorted;
 	grn_obj *ctidAccessor;
 	grn_obj *scoreAccessor;
+	List *valueExprStates;
+	bool opened;
+	PGrnCtidChecker ctidChecker;
+	grn_id *batchIDs;
+	ItemPointerData *batchCtids;
+	bool *batchAlives;
+	/* For heapSlot. They're allocated in batchMemoryContext. */
+	HeapTuple *batchTuples;
+	MemoryContext batchMemoryContext;
+	uint32 batchSize;
+	uint32 nBatchRecords;
+	uint32 batchPosition;
+	PGrnScanParallelSharedData *parallelShared;
+	PGrnScanParallelRecord *parallelRecords;
+	PGrnScanStatistics statistics;
 } PGrnScanState;
 
 bool PGrnCustomScanInitialized = false;
@@ -63,6 +208,7 @@ static void PGrnBeginCustomScan(CustomScanState *customScanState,
 static TupleTableSlot *PGrnExecCustomScan(CustomScanState *customScanState);
 static void PGrnEndCustomScan(CustomScanState *customScanState);
 static void PGrnReScanCustomScan(CustomScanState *customScanState);
+static void PGrnShutdownCustomScan(CustomScanState *customScanState);
 static void PGrnExplainCustomScan(CustomScanState *customScanState,
 								  List *ancestors,
 								  ExplainState *es);
@@ -97,6 +243,7 @@ const struct CustomExecMethods PGrnExecuteMethods = {
 	.ExecCustomScan = PGrnExecCustomScan,
 	.EndCustomScan = PGrnEndCustomScan,
 	.ReScanCustomScan = PGrnReScanCustomScan,
+	.ShutdownCustomScan = PGrnShutdownCustomScan,
 
 	.ExplainCustomScan = PGrnExplainCustomScan,
 
@@ -164,8 +311,39 @@ PGrnOpInOpfamily(Relation index, Oid opNo)
 	return false;
 }
 
+static bool
+PGrnIsRelationVar(Node *node, RelOptInfo *rel)
+{
+	Var *var;
+
+	if (!IsA(node, Var))
+		return false;
+	var = (Var *) node;
+	return var->varno == rel->relid && var->varlevelsup == 0;
+}
+
+/*
+ * Whether the node can be used as a value of a scan key. A Const is
+ * used as-is. Other expressions such as a Param and an outer relation's
+ * Var are evaluated on each (re)scan. So they must not refer to the
+ * scanned relation and must not be volatile.
+ */
+static bool
+PGrnIsScanKeyValue(PlannerInfo *root, Node *node, RelOptInfo *rel)
+{
+	if (IsA(node, Const))
+		return true;
+	if (contain_volatile_functions(node))
+		return false;
+	if (bms_is_member(rel->relid, pgrn_pull_varnos(root, node)))
+		return false;
+	return true;
+}
+
 static List *
-PGrnScanKeySourceMake(Relation index,
+PGrnScanKeySourceMake(PlannerInfo *root,
+					  RelOptInfo *rel,
+					  Relation index,
 					  IndexInfo *indexInfo,
 					  List *args,
 					  Oid opNo,
@@ -177,27 +355,28 @@ PGrnScanKeySourceMake(Relation index,
 	Node *left = linitial(args);
 	Node *right = lsecond(args);
 	Var *column;
-	Const *value;
+	Expr *value;
 
 	int attributeNumber = 0;
 	int strategy;
 	Oid leftType;
 	Oid rightType;
 
-	if (nodeTag(left) == T_Var && nodeTag(right) == T_Const)
+	if (PGrnIsRelationVar(left, rel) && PGrnIsScanKeyValue(root, right, rel))
 	{
 		column = (Var *) left;
-		value = (Const *) right;
+		value = (Expr *) right;
 	}
-	else if (nodeTag(left) == T_Const && nodeTag(right) == T_Var)
+	else if (PGrnIsRelationVar(right, rel) &&
+			 PGrnIsScanKeyValue(root, left, rel))
 	{
 		column = (Var *) right;
-		value = (Const *) left;
+		value = (Expr *) left;
 	}
 	else
 	{
 		elog(DEBUG1,
-			 "%s The arguments are not a pair of Var and Const. <%d op %d>",
+			 "%s The arguments are not a pair of Var and value. <%d op %d>",
 			 tag,
 			 nodeTag(left),
 			 nodeTag(right));
@@ -268,18 +447,30 @@ PGrnScanKeySourceGetOpFuncID(List *source)
 	return lthird_oid(lsecond(source));
 }
 
-static Const *
+static Expr *
 PGrnScanKeySourceGetValue(List *source)
 {
 	return linitial(lthird(source));
 }
 
 static List *
-PGrnCustomPrivateMake(Oid indexOID, List *scanKeySources, List *pathKeys)
+PGrnScanKeySourceCopyWithValue(List *source, Expr *value)
+{
+	return list_make3(linitial(source), lsecond(source), list_make1(value));
+}
+
+static List *
+PGrnCustomPrivateMake(Oid indexOID,
+					  List *scanKeySources,
+					  List *pathKeys,
+					  int limit)
 {
 	// Only a `Node` can be set to `custom_private`.
 	// See also the comments in PGrnScanKeySourceMake().
-	return list_make3(list_make1_oid(indexOID), scanKeySources, pathKeys);
+	return list_make4(list_make1_oid(indexOID),
+					  scanKeySources,
+					  pathKeys,
+					  list_make1_int(limit));
 }
 
 static Oid
@@ -300,8 +491,17 @@ PGrnCustomPrivateGetPathKeys(List *privateData)
 	return lthird(privateData);
 }
 
+static int
+PGrnCustomPrivateGetLimit(List *privateData)
+{
+	return linitial_int(lfourth(privateData));
+}
+
 static List *
-PGrnCollectScanKeySources(Relation index, List *quals)
+PGrnCollectScanKeySources(PlannerInfo *root,
+						  RelOptInfo *rel,
+						  Relation index,
+						  List *quals)
 {
 	const char *tag = "pgroonga: [custom-scan][scankey-sources][collect]";
 	IndexInfo *indexInfo = BuildIndexInfo(index);
@@ -333,7 +533,9 @@ PGrnCollectScanKeySources(Relation index, List *quals)
 				continue;
 			}
 
-			scanKeySource = PGrnScanKeySourceMake(index,
+			scanKeySource = PGrnScanKeySourceMake(root,
+												  rel,
+												  index,
 												  indexInfo,
 												  opexpr->args,
 												  opexpr->opno,
@@ -360,7 +562,9 @@ PGrnCollectScanKeySources(Relation index, List *quals)
 					 list_length(opexpr->args));
 				continue;
 			}
-			scanKeySource = PGrnScanKeySourceMake(index,
+			scanKeySource = PGrnScanKeySourceMake(root,
+												  rel,
+												  index,
 												  indexInfo,
 												  opexpr->args,
 												  opexpr->opno,
@@ -401,8 +605,46 @@ PGrnTableColumnName(Relation table, Var *var)
 	return NameStr(attr->attname);
 }
 
+static bool
+PGrnIsScoreFunction(Expr *expr)
+{
+	if (!IsA(expr, FuncExpr))
+		return false;
+	return strcmp(get_func_name(((FuncExpr *) expr)->funcid),
+				  "pgroonga_score") == 0;
+}
+
+/*
+ * Whether this is pgroonga_score() for this relation such as
+ * `pgroonga_score(tableoid, ctid)` and `pgroonga_score(memos)`. All
+ * arguments must be Vars of this relation.
+ */
+static bool
+PGrnIsRelationScoreFunction(Expr *expr, RelOptInfo *rel)
+{
+	ListCell *cell;
+
+	if (!PGrnIsScoreFunction(expr))
+		return false;
+
+	foreach (cell, ((FuncExpr *) expr)->args)
+	{
+		Node *arg = (Node *) lfirst(cell);
+		if (!PGrnIsRelationVar(arg, rel))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Returns sort clauses that can be sorted in Groonga. Index columns
+ * and pgroonga_score() can be sorted.
+ */
 static List *
-PGrnIndexSortClauses(Relation table, Relation index, PlannerInfo *plannerInfo)
+PGrnIndexSortClauses(Relation table,
+					 Relation index,
+					 PlannerInfo *plannerInfo,
+					 RelOptInfo *rel)
 {
 	List *indexSortClauses = NIL;
 	ListCell *cell;
@@ -421,20 +663,85 @@ PGrnIndexSortClauses(Relation table, Relation index, PlannerInfo *plannerInfo)
 				indexSortClauses = lappend(indexSortClauses, sortGroupClause);
 			}
 		}
+		else if (PGrnIsRelationScoreFunction(expr, rel))
+		{
+			indexSortClauses = lappend(indexSortClauses, sortGroupClause);
+		}
 	}
 	return indexSortClauses;
 }
 
+/*
+ * Returns the number of records to be sorted at first. It's
+ * LIMIT + OFFSET when they are constants. 0 means that all records are
+ * sorted.
+ *
+ * This is just a hint. If there are dead tuples in the sorted records,
+ * more records are sorted while executing.
+ */
+static int
+PGrnSortLimit(PlannerInfo *plannerInfo)
+{
+	if (plannerInfo->limit_tuples <= 0)
+		return 0;
+	if (plannerInfo->limit_tuples > INT_MAX)
+		return 0;
+	// LIMIT is for the whole query. We can't use it for a relation in
+	// a join.
+	if (bms_membership(plannerInfo->all_baserels) != BMS_SINGLETON)
+		return 0;
+	return (int) (plannerInfo->limit_tuples);
+}
+
+static void
+PGrnSearchBuildScanKeySourceCondition(Relation index,
+									  List *scanKeySource,
+									  Datum value,
+									  PGrnSearchData *data)
+{
+	int flags = PGrnScanKeySourceGetFlags(scanKeySource);
+	int attributeNumber = PGrnScanKeySourceGetIndexAttrNumber(scanKeySource);
+	int strategy = PGrnScanKeySourceGetIndexStrategy(scanKeySource);
+	Oid varType = PGrnScanKeySourceGetVarType(scanKeySource);
+	Oid collation = PGrnScanKeySourceGetCollation(scanKeySource);
+	Oid opfuncid = PGrnScanKeySourceGetOpFuncID(scanKeySource);
+
+	ScanKeyData key;
+	ScanKeyEntryInitialize(&key,
+						   flags,
+						   attributeNumber,
+						   strategy,
+						   varType,
+						   collation,
+						   opfuncid,
+						   value);
+
+	PGrnSearchBuildCondition(index, &key, data);
+}
+
+/*
+ * Returns custom_private candidates. One candidate is returned for each
+ * PGroonga index that can be used for all the quals. The planner
+ * chooses the cheapest one.
+ *
+ * joinQuals are join clauses for parameterized custom scan. All quals
+ * and joinQuals must be used as search conditions because the custom
+ * scan doesn't evaluate quals by itself.
+ */
 static List *
-PGrnChooseIndex(Relation table, PlannerInfo *plannerInfo, List *quals)
+PGrnChooseIndexes(Relation table,
+				  PlannerInfo *plannerInfo,
+				  RelOptInfo *rel,
+				  List *quals,
+				  List *joinQuals)
 {
 	// todo: Support pgroonga_condition() index specification.
-	// todo: Implementation of the logic for choosing which index to use.
 	ListCell *cell;
 	List *indexes = NIL;
+	List *candidates = NIL;
 
 	if (!table)
-		return NULL;
+		return NIL;
 
 	indexes = RelationGetIndexList(table);
 	foreach (cell, indexes)
@@ -444,13 +751,31 @@ PGrnChooseIndex(Relation table, PlannerInfo *plannerInfo, List *quals)
 		List *scanKeySources = NIL;
 		List *sortClauses = NIL;
 		List *pathKeys = NIL;
+		int limit = 0;
 		if (!PGrnIndexIsPGroonga(index))
 		{
 			RelationClose(index);
 			continue;
 		}
-		scanKeySources = PGrnCollectScanKeySources(index, quals);
-		sortClauses = PGrnIndexSortClauses(table, index, plannerInfo);
+		scanKeySources =
+			PGrnCollectScanKeySources(plannerInfo, rel, index, quals);
+		if (list_length(scanKeySources) != list_length(quals))
+		{
+			RelationClose(index);
+			continue;
+		}
+		if (joinQuals)
+		{
+			List *joinScanKeySources =
+				PGrnCollectScanKeySources(plannerInfo, rel, index, joinQuals);
+			if (list_length(joinScanKeySources) != list_length(joinQuals))
+			{
+				RelationClose(index);
+				continue;
+			}
+			scanKeySources = list_concat(scanKeySources, joinScanKeySources);
+		}
+		sortClauses = PGrnIndexSortClauses(table, index, plannerInfo, rel);
 		RelationClose(index);
 		if (!scanKeySources)
 			continue;
@@ -459,62 +784,157 @@ PGrnChooseIndex(Relation table, PlannerInfo *plannerInfo, List *quals)
 		{
 			pathKeys = make_pathkeys_for_sortclauses(
 				plannerInfo, sortClauses, plannerInfo->parse->targetList);
+			limit = PGrnSortLimit(plannerInfo);
 		}
-		return PGrnCustomPrivateMake(indexOID, scanKeySources, pathKeys);
+		candidates = lappend(
+			candidates,
+			PGrnCustomPrivateMake(indexOID, scanKeySources, pathKeys, limit));
 	}
-	return NIL;
+	return candidates;
 }
 
-static void
-PGrnSetRelPathlistHook(PlannerInfo *root,
-					   RelOptInfo *rel,
-					   Index rti,
-					   RangeTblEntry *rte)
+/*
+ * Estimates the number of records matched in Groonga. This uses the
+ * same logic as pgroonga_costestimate().
+ *
+ * Values that aren't Const such as parameters aren't known yet. They
+ * are ignored. If all values aren't known, the default selectivity is
+ * used.
+ */
+static double
+PGrnCustomPathEstimateNHits(Relation index,
+							grn_obj *sourcesTable,
+							List *scanKeySources)
 {
-	CustomPath *cpath;
-	List *privateData = NIL;
+	PGrnSearchData data;
+	double selectivity = PGrnDefaultSelectivity;
+	int nConditions = 0;
+	ListCell *cell;
 
-	if (PreviousSetRelPathlistHook)
+	PGrnSearchDataInit(&data, index, sourcesTable);
+	foreach (cell, scanKeySources)
 	{
-		PreviousSetRelPathlistHook(root, rel, rti, rte);
+		List *scanKeySource = (List *) lfirst(cell);
+		Expr *value = PGrnScanKeySourceGetValue(scanKeySource);
+		if (!IsA(value, Const))
+			continue;
+		PGrnSearchBuildScanKeySourceCondition(
+			index, scanKeySource, ((Const *) value)->constvalue, &data);
+		nConditions++;
 	}
+	if (nConditions > 0)
+		selectivity = PGrnCostEstimateSelectivity(sourcesTable, &data);
+	PGrnSearchDataFree(&data);
 
-	if (!PGrnCustomScanGetEnabled())
+	return grn_table_size(ctx, sourcesTable) * selectivity;
+}
+
+/*
+ * Estimates the cost to search and sort records in Groonga. All of
+ * them are done before the first tuple is returned. This uses the
+ * same cost model as pgroonga_costestimate() including Groonga's page
+ * I/O.
+ */
+static Cost
+PGrnCustomPathEstimateStartupCost(PlannerInfo *root, List *privateData)
+{
+	Relation index;
+	grn_obj *sourcesTable;
+	List *scanKeySources = PGrnCustomPrivateGetScanKeySources(privateData);
+	double nHits;
+	double indexPages;
+	Cost cost = 0.0;
+	ListCell *cell;
+
+	index = RelationIdGetRelation(PGrnCustomPrivateGetIndexOID(privateData));
+	sourcesTable = PGrnCostEstimateLookupSourcesTable(index);
+
+	foreach (cell, scanKeySources)
 	{
-		return;
+		List *scanKeySource = (List *) lfirst(cell);
+		int attributeNumber =
+			PGrnScanKeySourceGetIndexAttrNumber(scanKeySource);
+		cost += PGrnCostEstimateLexiconLookupCost(index, attributeNumber - 1);
 	}
 
-	if (get_rel_relkind(rte->relid) != RELKIND_RELATION)
+	nHits = PGrnCustomPathEstimateNHits(index, sourcesTable, scanKeySources);
+	cost += PGrnCostEstimateIOCost(
+		index, root, sourcesTable, clamp_row_est(nHits), 1.0, &indexPages);
+	RelationClose(index);
+	cost += nHits * PGrnPostingCost;
+
+	// The same comparison cost as cost_sort(). Only LIMIT + OFFSET
+	// records are sorted when LIMIT is given.
+	if (PGrnCustomPrivateGetPathKeys(privateData) && nHits > 1.0)
 	{
-		// First, support table scan.
-		return;
+		Cost comparisonCost = 2.0 * cpu_operator_cost;
+		int limit = PGrnCustomPrivateGetLimit(privateData);
+		if (limit > 0 && limit * 2.0 < nHits)
+			cost += comparisonCost * nHits * log2(2.0 * limit);
+		else
+			cost += comparisonCost * nHits * log2(nHits);
 	}
 
+	return cost;
+}
+
+/*
+ * The same as get_parallel_divisor() in costsize.c. It's not exported.
+ * The leader participates less as the number of workers increases.
+ */
+static double
+PGrnCustomPathGetParallelDivisor(Path *path)
+{
+	double parallelDivisor = path->parallel_workers;
+
+	if (parallel_leader_participation)
 	{
-		// Do not custom scan when no index exists for PGroonga.
-		Relation table = relation_open(rte->relid, AccessShareLock);
-		if (table)
-		{
-			List *quals = PGrnConvertExprList(rel->baserestrictinfo);
-			privateData = PGrnChooseIndex(table, root, quals);
-			relation_close(table, AccessShareLock);
-			if (!privateData)
-			{
-				return;
-			}
-		}
+		double leaderContribution = 1.0 - (0.3 * path->parallel_workers);
+		if (leaderContribution > 0)
+			parallelDivisor += leaderContribution;
 	}
 
-	cpath = makeNode(CustomPath);
+	return parallelDivisor;
+}
+
+/*
+ * Creates a custom path. If nWorkers is larger than 0, this creates a
+ * partial path for parallel custom scan. If paramInfo isn't NULL, this
+ * creates a parameterized path for the inner side of nested loop.
+ *
+ * startupCost is the cost to search and sort in Groonga. Only one
+ * participant searches in parallel custom scan but others wait for
+ * it. So startupCost is the same for parallel custom scan.
+ */
+static CustomPath *
+PGrnCustomPathMake(RelOptInfo *rel,
+				   List *privateData,
+				   ParamPathInfo *paramInfo,
+				   Cost startupCost,
+				   int nWorkers)
+{
+	CustomPath *cpath = makeNode(CustomPath);
 	cpath->path.pathtype = T_CustomScan;
 	cpath->path.parent = rel;
 	cpath->path.pathtarget = rel->reltarget;
+	cpath->path.param_info = paramInfo;
 	cpath->path.pathkeys = PGrnCustomPrivateGetPathKeys(privateData);
+	if (paramInfo)
+		cpath->path.rows = paramInfo->ppi_rows;
+	else
+		cpath->path.rows = rel->rows;
+	if (nWorkers > 0)
+	{
+		double parallelDivisor;
 
-	// todo
-	// Set appropriately according to the function to be executed.
-	// cpath->path.parallel_aware = true;
-	// cpath->path.parallel_safe = true;
+		cpath->path.parallel_aware = true;
+		cpath->path.parallel_safe = true;
+		cpath->path.parallel_workers = nWorkers;
+		parallelDivisor = PGrnCustomPathGetParallelDivisor(&(cpath->path));
+		cpath->path.rows = clamp_row_est(rel->rows / parallelDivisor);
+	}
+	cpath->path.startup_cost = startupCost;
+	cpath->path.total_cost = startupCost + cpu_tuple_cost * cpath->path.rows;
 
 	cpath->custom_private = privateData;
 
@@ -524,7 +944,128 @@ PGrnSetRelPathlistHook(PlannerInfo *root,
 
 	cpath->methods = &PGrnPathMethods;
 
-	add_path(rel, &cpath->path);
+	return cpath;
+}
+
+static void
+PGrnAddCustomPaths(PlannerInfo *root,
+				   RelOptInfo *rel,
+				   Relation table,
+				   Relids requiredOuter)
+{
+	ParamPathInfo *paramInfo =
+		get_baserel_parampathinfo(root, rel, requiredOuter);
+	List *quals = PGrnConvertExprList(rel->baserestrictinfo);
+	List *joinQuals = NIL;
+	List *candidates;
+	ListCell *cell;
+
+	if (paramInfo)
+		joinQuals = PGrnConvertExprList(paramInfo->ppi_clauses);
+	candidates = PGrnChooseIndexes(table, root, rel, quals, joinQuals);
+	foreach (cell, candidates)
+	{
+		List *privateData = (List *) lfirst(cell);
+		Cost startupCost =
+			PGrnCustomPathEstimateStartupCost(root, privateData);
+		CustomPath *cpath =
+			PGrnCustomPathMake(rel, privateData, paramInfo, startupCost, 0);
+		add_path(rel, &cpath->path);
+
+		// Parallel custom scan doesn't keep the sort order.
+		if (rel->consider_parallel && !paramInfo && !cpath->path.pathkeys)
+		{
+			int nWorkers = compute_parallel_worker(
+				rel, rel->pages, -1, max_parallel_workers_per_gather);
+			if (nWorkers > 0)
+			{
+				cpath = PGrnCustomPathMake(
+					rel, privateData, NULL, startupCost, nWorkers);
+				add_partial_path(rel, &cpath->path);
+			}
+		}
+	}
+}
+
+/*
+ * Returns sets of outer relations that can be used for parameterized
+ * custom scan. Join clauses such as `memos.content &@~ queries.query`
+ * can be used as search conditions when this relation is the inner
+ * side of nested loop.
+ *
+ * The first element is for non parameterized scan. It's NULL unless
+ * this relation has lateral references.
+ */
+static List *
+PGrnCollectRequiredOuters(RelOptInfo *rel)
+{
+	List *requiredOuters = list_make1(rel->lateral_relids);
+	ListCell *cell;
+
+	foreach (cell, rel->joininfo)
+	{
+		RestrictInfo *info = (RestrictInfo *) lfirst(cell);
+		Relids requiredOuter;
+		bool found = false;
+		ListCell *outerCell;
+
+		if (!join_clause_is_movable_to(info, rel))
+			continue;
+
+		requiredOuter = bms_union(
+			bms_difference(info->clause_relids, rel->relids),
+			rel->lateral_relids);
+		foreach (outerCell, requiredOuters)
+		{
+			if (bms_equal(requiredOuter, (Relids) lfirst(outerCell)))
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			requiredOuters = lappend(requiredOuters, requiredOuter);
+	}
+	return requiredOuters;
+}
+
+static void
+PGrnSetRelPathlistHook(PlannerInfo *root,
+					   RelOptInfo *rel,
+					   Index rti,
+					   RangeTblEntry *rte)
+{
+	Relation table;
+	List *requiredOuters;
+	ListCell *cell;
+
+	if (PreviousSetRelPathlistHook)
+	{
+		PreviousSetRelPathlistHook(root, rel, rti, rte);
+	}
+
+	if (!PGrnCustomScanGetEnabled())
+	{
+		return;
+	}
+
+	if (get_rel_relkind(rte->relid) != RELKIND_RELATION)
+	{
+		// First, support table scan.
+		return;
+	}
+
+	// Do not custom scan when no index exists for PGroonga.
+	table = relation_open(rte->relid, AccessShareLock);
+	if (!table)
+		return;
+
+	requiredOuters = PGrnCollectRequiredOuters(rel);
+	foreach (cell, requiredOuters)
+	{
+		PGrnAddCustomPaths(root, rel, table, (Relids) lfirst(cell));
+	}
+	relation_close(table, AccessShareLock);
 }
 
 static Plan *
@@ -536,21 +1077,53 @@ PGrnPlanCustomPath(PlannerInfo *root,
 				   List *custom_plans)
 {
 	CustomScan *cscan = makeNode(CustomScan);
+	ListCell *cell;
+
 	cscan->methods = &PGrnScanMethods;
 	cscan->scan.plan.qual = extract_actual_clauses(clauses, false);
 	cscan->scan.plan.targetlist = tlist;
 	cscan->scan.scanrelid = rel->relid;
 	cscan->custom_private = best_path->custom_private;
+	// Values of scan keys are evaluated in executor. They are put in
+	// custom_exprs because outer relation's Vars in custom_exprs are
+	// replaced with nested loop parameters.
+	foreach (cell,
+			 PGrnCustomPrivateGetScanKeySources(best_path->custom_private))
+	{
+		List *scanKeySource = (List *) lfirst(cell);
+		cscan->custom_exprs = lappend(cscan->custom_exprs,
+									  PGrnScanKeySourceGetValue(scanKeySource));
+	}
 
 	return &(cscan->scan.plan);
 }
 
+/*
+ * Translates the parent relation's Vars in scan key values to the child
+ * relation's Vars for partitionwise join.
+ */
 static List *
 PGrnReparameterizeCustomPathByChild(PlannerInfo *root,
 									List *custom_private,
 									RelOptInfo *child_rel)
 {
-	return NIL;
+	List *scanKeySources = NIL;
+	ListCell *cell;
+
+	foreach (cell, PGrnCustomPrivateGetScanKeySources(custom_private))
+	{
+		List *scanKeySource = (List *) lfirst(cell);
+		Node *value = pgrn_adjust_appendrel_attrs_multilevel(
+			root, (Node *) PGrnScanKeySourceGetValue(scanKeySource), child_rel);
+		scanKeySources = lappend(
+			scanKeySources,
+			PGrnScanKeySourceCopyWithValue(scanKeySource, (Expr *) value));
+	}
+	return PGrnCustomPrivateMake(
+		PGrnCustomPrivateGetIndexOID(custom_private),
+		scanKeySources,
+		PGrnCustomPrivateGetPathKeys(custom_private),
+		PGrnCustomPrivateGetLimit(custom_private));
 }
 
 static Node *
@@ -565,17 +1138,35 @@ PGrnCreateCustomScanState(CustomScan *cscan)
 	state->parent.methods = &PGrnExecuteMethods;
 
 	state->tableCursor = NULL;
-	GRN_PTR_INIT(&(state->columns), GRN_OBJ_VECTOR, GRN_ID_NIL);
+	state->targets = NULL;
+	state->nTargets = 0;
+	state->heapSlot = NULL;
 	GRN_VOID_INIT(&(state->columnValue));
 	memset(&(state->searchData), 0, sizeof(state->searchData));
 	state->searched = NULL;
 	state->sorted = NULL;
 	state->ctidAccessor = NULL;
 	state->scoreAccessor = NULL;
+	state->valueExprStates = NIL;
+	state->opened = false;
+	state->batchIDs = NULL;
+	state->batchCtids = NULL;
+	state->batchAlives = NULL;
+	state->batchTuples = NULL;
+	state->batchMemoryContext = NULL;
+	state->batchSize = 0;
+	state->nBatchRecords = 0;
+	state->batchPosition = 0;
+	state->parallelShared = NULL;
+	state->parallelRecords = NULL;
+	memset(&(state->statistics), 0, sizeof(state->statistics));
+	GRN_TEXT_INIT(&(state->statistics.expression), 0);
 	state->indexOID = PGrnCustomPrivateGetIndexOID(cscan->custom_private);
 	state->scanKeySources =
 		PGrnCustomPrivateGetScanKeySources(cscan->custom_private);
 	state->pathKeys = PGrnCustomPrivateGetPathKeys(cscan->custom_private);
+	state->limit = PGrnCustomPrivateGetLimit(cscan->custom_private);
+	state->nSortedRecords = 0;
 
 	return (Node *) &(state->parent);
 }
@@ -589,95 +1180,126 @@ PGrnIsIndexValueUsed(Relation index, const char *columnName, Oid typeID)
 }
 
 static void
-PGrnSetTargetColumns(CustomScanState *customScanState,
-					 Relation index,
-					 grn_obj *targetTable)
+PGrnInitTargets(CustomScanState *customScanState)
 {
 	PGrnScanState *state = (PGrnScanState *) customScanState;
 	Relation table = customScanState->ss.ss_currentRelation;
+	Relation index;
+	List *targetList = customScanState->ss.ps.plan->targetlist;
 	ListCell *cell;
+	bool needHeapSlot = false;
+	int i = 0;
 
-	foreach (cell, customScanState->ss.ps.plan->targetlist)
+	index = RelationIdGetRelation(state->indexOID);
+	state->nTargets = list_length(targetList);
+	state->targets =
+		(PGrnScanTarget *) palloc0(sizeof(PGrnScanTarget) * state->nTargets);
+	foreach (cell, targetList)
 	{
 		TargetEntry *entry = (TargetEntry *) lfirst(cell);
+		PGrnScanTarget *target = &(state->targets[i++]);
+
+		target->type = PGRN_SCAN_TARGET_UNSUPPORTED;
+		target->typeID = exprType((Node *) (entry->expr));
 		if (IsA(entry->expr, Var))
 		{
 			Var *var = (Var *) entry->expr;
 			const char *name = PGrnTableColumnName(table, var);
-			if (PGrnIsIndexValueUsed(
-					index, name, exprType((Node *) (entry->expr))))
+			target->attributeNumber = var->varattno;
+			if (PGrnIsIndexValueUsed(index, name, target->typeID))
+			{
+				target->type = PGRN_SCAN_TARGET_INDEX_COLUMN;
+				target->columnName = name;
+			}
+			else
+			{
+				target->type = PGRN_SCAN_TARGET_HEAP_COLUMN;
+				needHeapSlot = true;
+			}
+		}
+		else if (IsA(entry->expr, FuncExpr))
+		{
+			FuncExpr *funcExpr = (FuncExpr *) (entry->expr);
+			if (PGrnIsScoreFunction((Expr *) funcExpr))
 			{
-				grn_obj *column = PGrnLookupColumn(targetTable, name, ERROR);
-				GRN_PTR_PUT(ctx, &(state->columns), column);
+				// todo
+				// Reject this function if the argument isn't
+				// `(tableoid, ctid)` nor `(record)`.
+				target->type = PGRN_SCAN_TARGET_SCORE;
 			}
 			else
 			{
-				GRN_PTR_PUT(ctx, &(state->columns), NULL);
+				target->type = PGRN_SCAN_TARGET_EXPRESSION;
+				target->exprState = ExecInitExpr((Expr *) funcExpr,
+												 &(customScanState->ss.ps));
+				// Vars in the expression are read from the heap tuple.
+				if (contain_var_clause((Node *) funcExpr))
+					needHeapSlot = true;
 			}
 		}
 	}
+	RelationClose(index);
+
+	if (needHeapSlot)
+	{
+		state->heapSlot = MakeSingleTupleTableSlot(RelationGetDescr(table),
+												   &TTSOpsHeapTuple);
+	}
 }
 
 static void
-PGrnSearchBuildCustomScanConditions(CustomScanState *customScanState,
-									Relation index)
+PGrnSetTargetColumns(CustomScanState *customScanState, grn_obj *targetTable)
 {
 	PGrnScanState *state = (PGrnScanState *) customScanState;
-	ListCell *cell;
-	foreach (cell, state->scanKeySources)
-	{
-		List *scanKeySource = (List *) lfirst(cell);
-		int flags = PGrnScanKeySourceGetFlags(scanKeySource);
-		int attributeNumber =
-			PGrnScanKeySourceGetIndexAttrNumber(scanKeySource);
-		int strategy = PGrnScanKeySourceGetIndexStrategy(scanKeySource);
-		Oid varType = PGrnScanKeySourceGetVarType(scanKeySource);
-		Oid collation = PGrnScanKeySourceGetCollation(scanKeySource);
-		Oid opfuncid = PGrnScanKeySourceGetOpFuncID(scanKeySource);
-		Const *value = PGrnScanKeySourceGetValue(scanKeySource);
 
-		ScanKeyData key;
-		ScanKeyEntryInitialize(&key,
-							   flags,
-							   attributeNumber,
-							   strategy,
-							   varType,
-							   collation,
-							   opfuncid,
-							   value->constvalue);
-
-		PGrnSearchBuildCondition(index, &key, &(state->searchData));
+	for (int i = 0; i < state->nTargets; i++)
+	{
+		PGrnScanTarget *target = &(state->targets[i]);
+		if (target->type != PGRN_SCAN_TARGET_INDEX_COLUMN)
+			continue;
+		target->column =
+			PGrnLookupColumn(targetTable, target->columnName, ERROR);
 	}
 }
 
+/*
+ * Sorts the next at most `limit` records of the searched records and
+ * appends them to state->sorted. Negative `limit` means all the rest
+ * records.
+ */
 static void
-PGrnCustomScanSort(CustomScanState *customScanState)
+PGrnCustomScanSort(CustomScanState *customScanState, int limit)
 {
 	const char *tag = "pgroonga: [custom-scan][sort]";
 	PGrnScanState *state = (PGrnScanState *) customScanState;
 	Relation table = customScanState->ss.ss_currentRelation;
 	int nPathKeys = list_length(state->pathKeys);
-	grn_table_sort_key *sortKeys =
-		(grn_table_sort_key *) palloc(sizeof(grn_table_sort_key) * nPathKeys);
+	// +1 for _id.
+	grn_table_sort_key *sortKeys = (grn_table_sort_key *) palloc(
+		sizeof(grn_table_sort_key) * (nPathKeys + 1));
 	ListCell *cell;
 	unsigned int nSortKeys = 0;
+	instr_time startTime;
+	instr_time endTime;
 	foreach (cell, state->pathKeys)
 	{
 		PathKey *pathKey = (PathKey *) lfirst(cell);
 		EquivalenceMember *member = linitial(pathKey->pk_eclass->ec_members);
 		Expr *expr = (Expr *) (member->em_expr);
+		grn_obj *key;
 		if (IsA(expr, Var))
 		{
 			// Support only simple sorting by columns.
 			Var *var = (Var *) expr;
 			const char *name = PGrnTableColumnName(table, var);
-			sortKeys[nSortKeys].key =
-				grn_obj_column(ctx, state->searched, name, strlen(name));
-			if (pathKey->pk_cmptype == COMPARE_LT)
-				sortKeys[nSortKeys].flags = GRN_TABLE_SORT_ASC;
-			else if (pathKey->pk_cmptype == COMPARE_GT)
-				sortKeys[nSortKeys].flags = GRN_TABLE_SORT_DESC;
-			nSortKeys++;
+			key = grn_obj_column(ctx, state->searched, name, strlen(name));
+		}
+		else if (PGrnIsScoreFunction(expr))
+		{
+			key = grn_obj_column(ctx,
+								 state->searched,
+								 GRN_COLUMN_NAME_SCORE,
+								 GRN_COLUMN_NAME_SCORE_LEN);
 		}
 		else
 		{
@@ -686,236 +1308,801 @@ PGrnCustomScanSort(CustomScanState *customScanState)
 			pfree(pathKeyStr);
 			continue;
 		}
+		sortKeys[nSortKeys].key = key;
+		if (pathKey->pk_cmptype == COMPARE_LT)
+			sortKeys[nSortKeys].flags = GRN_TABLE_SORT_ASC;
+		else if (pathKey->pk_cmptype == COMPARE_GT)
+			sortKeys[nSortKeys].flags = GRN_TABLE_SORT_DESC;
+		nSortKeys++;
+	}
+	if (state->limit > 0)
+	{
+		// Records are sorted partially. We need a stable order to sort
+		// the next records without duplicates and missing records.
+		sortKeys[nSortKeys].key = grn_obj_column(
+			ctx, state->searched, GRN_COLUMN_NAME_ID, GRN_COLUMN_NAME_ID_LEN);
+		sortKeys[nSortKeys].flags = GRN_TABLE_SORT_ASC;
+		nSortKeys++;
 	}
 
-	state->sorted = grn_table_create(
-		ctx, NULL, 0, NULL, GRN_OBJ_TABLE_NO_KEY, NULL, state->searched);
-	grn_table_sort(
-		ctx, state->searched, 0, -1, state->sorted, sortKeys, nSortKeys);
+	if (!state->sorted)
+	{
+		state->sorted = grn_table_create(
+			ctx, NULL, 0, NULL, GRN_OBJ_TABLE_NO_KEY, NULL, state->searched);
+	}
+	INSTR_TIME_SET_CURRENT(startTime);
+	state->nSortedRecords += grn_table_sort(ctx,
+											state->searched,
+											state->nSortedRecords,
+											limit,
+											state->sorted,
+											sortKeys,
+											nSortKeys);
+	INSTR_TIME_SET_CURRENT(endTime);
+	INSTR_TIME_ACCUM_DIFF(state->statistics.sortTime, endTime, startTime);
 
 	for (unsigned int i = 0; i < nSortKeys; i++)
 		grn_obj_unlink(ctx, sortKeys[i].key);
 	pfree(sortKeys);
 }
 
-static void
-PGrnBeginCustomScan(CustomScanState *customScanState,
-					EState *estate,
-					int eflags)
+static grn_obj *
+PGrnCustomScanCreateSearched(grn_obj *sourcesTable)
 {
-	PGrnScanState *state;
-	Relation index;
-	grn_obj *sourcesTable;
+	return grn_table_create(ctx,
+							NULL,
+							0,
+							NULL,
+							GRN_OBJ_TABLE_HASH_KEY | GRN_OBJ_WITH_SUBREC,
+							sourcesTable,
+							0);
+}
 
-	if (!PGrnCustomScanInitialized)
-		return;
+/*
+ * Groonga uses loose search when the number of matched records is equal
+ * to or less than the match escalation threshold. Groonga doesn't tell
+ * the number of matched records without match escalation. The
+ * estimated size, that is for exact match, is used instead of
+ * searching again. So this may be wrong when the estimation is wrong.
+ * This is only for EXPLAIN ANALYZE and it's shown as estimated.
+ */
+static bool
+PGrnCustomScanIsMatchEscalated(CustomScanState *customScanState,
+							   unsigned int nEstimatedHits)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
 
-	state = (PGrnScanState *) customScanState;
-	index = RelationIdGetRelation(state->indexOID);
-	sourcesTable = PGrnLookupSourcesTable(index, ERROR);
-	PGrnSearchDataInit(&(state->searchData), index, sourcesTable);
-	PGrnSearchBuildCustomScanConditions(customScanState, index);
+	if (PGrnForceMatchEscalation)
+		return true;
+	if (PGrnMatchEscalationThreshold < 0)
+		return false;
+	if (grn_table_size(ctx, state->searched) <=
+		(unsigned int) PGrnMatchEscalationThreshold)
+		return true;
+	return nEstimatedHits <= (unsigned int) PGrnMatchEscalationThreshold;
+}
 
-	if (!state->searchData.isEmptyCondition)
+static void
+PGrnCustomScanCollectSearchStatistics(CustomScanState *customScanState)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	PGrnScanStatistics *statistics = &(state->statistics);
+	grn_obj *expression = &(statistics->expression);
+	const char *inspected;
+	size_t i;
+	unsigned int nEstimatedHits;
+
+	// The last expression is shown. Newlines are replaced with spaces
+	// because EXPLAIN shows it in one line.
+	inspected = PGrnInspect(state->searchData.expression);
+	GRN_BULK_REWIND(expression);
+	for (i = 0; inspected[i] != '\0'; i++)
 	{
-		grn_obj *targetTable = NULL;
-		grn_table_selector *table_selector = grn_table_selector_open(
-			ctx, sourcesTable, state->searchData.expression, GRN_OP_OR);
-		grn_table_selector_set_fuzzy_max_distance_ratio(
-			ctx, table_selector, state->searchData.fuzzyMaxDistanceRatio);
-
-		state->searched =
-			grn_table_create(ctx,
-							 NULL,
-							 0,
-							 NULL,
-							 GRN_OBJ_TABLE_HASH_KEY | GRN_OBJ_WITH_SUBREC,
-							 sourcesTable,
-							 0);
-		grn_table_selector_select(ctx, table_selector, state->searched);
-		grn_table_selector_close(ctx, table_selector);
-
-		if (state->pathKeys)
-			PGrnCustomScanSort(customScanState);
-		if (state->sorted)
-			targetTable = state->sorted;
-		else
-			targetTable = state->searched;
-
-		PGrnSetTargetColumns(customScanState, index, targetTable);
-		state->tableCursor = grn_table_cursor_open(
-			ctx, targetTable, NULL, 0, NULL, 0, 0, -1, GRN_CURSOR_ASCENDING);
-		if (sourcesTable->header.type == GRN_TABLE_NO_KEY)
+		if (inspected[i] == '\n')
 		{
-			state->ctidAccessor =
-				grn_obj_column(ctx,
-							   targetTable,
-							   PGrnSourcesCtidColumnName,
-							   PGrnSourcesCtidColumnNameLength);
+			GRN_TEXT_PUTC(ctx, expression, ' ');
+			while (inspected[i + 1] == ' ')
+				i++;
 		}
 		else
 		{
-			state->ctidAccessor = grn_obj_column(
-				ctx, targetTable, GRN_COLUMN_NAME_KEY, GRN_COLUMN_NAME_KEY_LEN);
+			GRN_TEXT_PUTC(ctx, expression, inspected[i]);
 		}
-		state->scoreAccessor = grn_obj_column(
-			ctx, targetTable, GRN_COLUMN_NAME_SCORE, GRN_COLUMN_NAME_SCORE_LEN);
 	}
 
-	RelationClose(index);
-	PGrnSearchDataFree(&(state->searchData));
-	memset(&(state->searchData), 0, sizeof(state->searchData));
+	nEstimatedHits = grn_expr_estimate_size(ctx, state->searchData.expression);
+	statistics->nEstimatedHits += nEstimatedHits;
+	if (PGrnCustomScanIsMatchEscalated(customScanState, nEstimatedHits))
+		statistics->matchEscalated = true;
 }
 
-static TupleTableSlot *
+/*
+ * Searches records and stores them to state->searched. This returns
+ * false when there is no condition to search or a value is NULL.
+ *
+ * Values of scan keys are evaluated here. So this is called for each
+ * rescan with the current parameters. state->searched is reused on
+ * rescan.
+ */
+static bool
+PGrnCustomScanSearch(CustomScanState *customScanState,
+					 Relation index,
+					 grn_obj *sourcesTable)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	ExprContext *econtext = customScanState->ss.ps.ps_ExprContext;
+	ListCell *sourceCell;
+	ListCell *valueCell;
+	bool haveNullValue = false;
+	bool searched = false;
+
+	PGrnSearchDataInit(&(state->searchData), index, sourcesTable);
+	forboth (sourceCell,
+			 state->scanKeySources,
+			 valueCell,
+			 state->valueExprStates)
+	{
+		List *scanKeySource = (List *) lfirst(sourceCell);
+		ExprState *valueExprState = (ExprState *) lfirst(valueCell);
+		bool isNull = false;
+		Datum value = ExecEvalExpr(valueExprState, econtext, &isNull);
+		// All operators for PGroonga are strict. No record matches.
+		if (isNull)
+		{
+			haveNullValue = true;
+			break;
+		}
+		PGrnSearchBuildScanKeySourceCondition(
+			index, scanKeySource, value, &(state->searchData));
+	}
+
+	if (!haveNullValue && !state->searchData.isEmptyCondition)
+	{
+		grn_table_selector *table_selector = grn_table_selector_open(
+			ctx, sourcesTable, state->searchData.expression, GRN_OP_OR);
+		instr_time startTime;
+		instr_time endTime;
+
+		grn_table_selector_set_fuzzy_max_distance_ratio(
+			ctx, table_selector, state->searchData.fuzzyMaxDistanceRatio);
+
+		if (!state->searched)
+			state->searched = PGrnCustomScanCreateSearched(sourcesTable);
+		INSTR_TIME_SET_CURRENT(startTime);
+		grn_table_selector_select(ctx, table_selector, state->searched);
+		INSTR_TIME_SET_CURRENT(endTime);
+		INSTR_TIME_ACCUM_DIFF(state->statistics.selectTime, endTime, startTime);
+		grn_table_selector_close(ctx, table_selector);
+		state->statistics.nHits += grn_table_size(ctx, state->searched);
+		if (state->statistics.enabled)
+			PGrnCustomScanCollectSearchStatistics(customScanState);
+		searched = true;
+	}
+
+	PGrnSearchDataFree(&(state->searchData));
+	memset(&(state->searchData), 0, sizeof(state->searchData));
+
+	return searched;
+}
+
+static void
+PGrnCustomScanOpenCursor(CustomScanState *customScanState,
+						 grn_obj *sourcesTable,
+						 grn_obj *targetTable)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+
+	state->tableCursor = grn_table_cursor_open(
+		ctx, targetTable, NULL, 0, NULL, 0, 0, -1, GRN_CURSOR_ASCENDING);
+
+	// Target columns and accessors are reused on rescan because
+	// targetTable is reused.
+	if (state->ctidAccessor)
+		return;
+
+	PGrnSetTargetColumns(customScanState, targetTable);
+	if (sourcesTable->header.type == GRN_TABLE_NO_KEY)
+	{
+		state->ctidAccessor = grn_obj_column(ctx,
+											 targetTable,
+											 PGrnSourcesCtidColumnName,
+											 PGrnSourcesCtidColumnNameLength);
+	}
+	else
+	{
+		state->ctidAccessor = grn_obj_column(
+			ctx, targetTable, GRN_COLUMN_NAME_KEY, GRN_COLUMN_NAME_KEY_LEN);
+	}
+	state->scoreAccessor = grn_obj_column(
+		ctx, targetTable, GRN_COLUMN_NAME_SCORE, GRN_COLUMN_NAME_SCORE_LEN);
+}
+
+static void
+PGrnCustomScanOpen(CustomScanState *customScanState)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	Relation index;
+	grn_obj *sourcesTable;
+
+	index = RelationIdGetRelation(state->indexOID);
+	sourcesTable = PGrnLookupSourcesTable(index, ERROR);
+	if (PGrnCustomScanSearch(customScanState, index, sourcesTable))
+	{
+		grn_obj *targetTable = NULL;
+
+		if (state->pathKeys)
+			PGrnCustomScanSort(customScanState,
+							   state->limit > 0 ? state->limit : -1);
+		if (state->sorted)
+			targetTable = state->sorted;
+		else
+			targetTable = state->searched;
+
+		PGrnCustomScanOpenCursor(customScanState, sourcesTable, targetTable);
+	}
+	RelationClose(index);
+	state->opened = true;
+}
+
+static void
+PGrnCustomScanParallelPublish(CustomScanState *customScanState)
+{
+	const char *tag = "pgroonga: [custom-scan][parallel][publish]";
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	PGrnScanParallelSharedData *shared = state->parallelShared;
+	dsa_area *area = customScanState->ss.ps.state->es_query_dsa;
+	uint64 nRecords = 0;
+	dsa_pointer recordsPointer = InvalidDsaPointer;
+
+	if (state->searched)
+		nRecords = grn_table_size(ctx, state->searched);
+
+	if (nRecords > 0)
+	{
+		PGrnScanParallelRecord *records;
+		grn_obj *scoreAccessor;
+		grn_obj score;
+		uint64 i = 0;
+
+		recordsPointer =
+			dsa_allocate_extended(area,
+								  sizeof(PGrnScanParallelRecord) * nRecords,
+								  DSA_ALLOC_HUGE);
+		records = dsa_get_address(area, recordsPointer);
+		state->parallelRecords = records;
+
+		scoreAccessor = grn_obj_column(ctx,
+									   state->searched,
+									   GRN_COLUMN_NAME_SCORE,
+									   GRN_COLUMN_NAME_SCORE_LEN);
+		GRN_FLOAT_INIT(&score, 0);
+		GRN_TABLE_EACH_BEGIN(ctx, state->searched, cursor, id)
+		{
+			grn_table_get_key(
+				ctx, state->searched, id, &(records[i].id), sizeof(grn_id));
+			GRN_BULK_REWIND(&score);
+			grn_obj_get_value(ctx, scoreAccessor, id, &score);
+			if (score.header.domain == GRN_DB_FLOAT)
+				records[i].score = GRN_FLOAT_VALUE(&score);
+			else
+				records[i].score = GRN_INT32_VALUE(&score);
+			i++;
+		}
+		GRN_TABLE_EACH_END(ctx, cursor);
+		GRN_OBJ_FIN(ctx, &score);
+		grn_obj_unlink(ctx, scoreAccessor);
+	}
+
+	GRN_LOG(ctx,
+			GRN_LOG_DEBUG,
+			"%s <%u>: <%" PRIu64 ">",
+			tag,
+			state->indexOID,
+			(uint64_t) nRecords);
+
+	SpinLockAcquire(&(shared->mutex));
+	shared->records = recordsPointer;
+	shared->nRecords = nRecords;
+	shared->published = true;
+	SpinLockRelease(&(shared->mutex));
+	ConditionVariableBroadcast(&(shared->conditionVariable));
+}
+
+static void
+PGrnCustomScanParallelWait(CustomScanState *customScanState)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	PGrnScanParallelSharedData *shared = state->parallelShared;
+	dsa_area *area = customScanState->ss.ps.state->es_query_dsa;
+	dsa_pointer recordsPointer;
+
+	ConditionVariablePrepareToSleep(&(shared->conditionVariable));
+	while (true)
+	{
+		bool published;
+
+		SpinLockAcquire(&(shared->mutex));
+		published = shared->published;
+		SpinLockRelease(&(shared->mutex));
+		if (published)
+			break;
+
+		ConditionVariableSleep(&(shared->conditionVariable),
+							   PG_WAIT_EXTENSION);
+	}
+	ConditionVariableCancelSleep();
+
+	SpinLockAcquire(&(shared->mutex));
+	recordsPointer = shared->records;
+	SpinLockRelease(&(shared->mutex));
+	if (DsaPointerIsValid(recordsPointer))
+		state->parallelRecords = dsa_get_address(area, recordsPointer);
+}
+
+/*
+ * Fills state->searched with the next chunk of the published result
+ * and opens a cursor for it. This returns false when all records are
+ * already claimed.
+ */
+static bool
+PGrnCustomScanParallelClaim(CustomScanState *customScanState)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	PGrnScanParallelSharedData *shared = state->parallelShared;
+	PGrnScanParallelRecord *records;
+	grn_obj score;
+	uint64 start;
+	uint64 end;
+	uint64 i;
+
+	if (state->tableCursor)
+	{
+		grn_table_cursor_close(ctx, state->tableCursor);
+		state->tableCursor = NULL;
+	}
+	grn_table_truncate(ctx, state->searched);
+
+	if (!state->parallelRecords)
+		return false;
+
+	start = pg_atomic_fetch_add_u64(&(shared->nextPosition),
+									PGRN_SCAN_PARALLEL_CHUNK_SIZE);
+	if (start >= shared->nRecords)
+		return false;
+	end = Min(start + PGRN_SCAN_PARALLEL_CHUNK_SIZE, shared->nRecords);
+
+	records = state->parallelRecords;
+	GRN_FLOAT_INIT(&score, 0);
+	for (i = start; i < end; i++)
+	{
+		grn_id id;
+
+		id = grn_table_add(
+			ctx, state->searched, &(records[i].id), sizeof(grn_id), NULL);
+		if (id == GRN_ID_NIL)
+			continue;
+		GRN_FLOAT_SET(ctx, &score, records[i].score);
+		grn_obj_set_value(
+			ctx, state->scoreAccessor, id, &score, GRN_OBJ_SET);
+	}
+	GRN_OBJ_FIN(ctx, &score);
+
+	state->tableCursor = grn_table_cursor_open(
+		ctx, state->searched, NULL, 0, NULL, 0, 0, -1, GRN_CURSOR_ASCENDING);
+	return true;
+}
+
+/*
+ * The first participant searches and publishes the result. Other
+ * participants wait for it. All participants claim chunks of the
+ * published result. So each participant's state->searched has only
+ * records in the claimed chunk.
+ */
+static void
+PGrnCustomScanParallelOpen(CustomScanState *customScanState)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	PGrnScanParallelSharedData *shared = state->parallelShared;
+	Relation index;
+	grn_obj *sourcesTable;
+	bool searcher = false;
+
+	SpinLockAcquire(&(shared->mutex));
+	if (!shared->searching)
+	{
+		shared->searching = true;
+		searcher = true;
+	}
+	SpinLockRelease(&(shared->mutex));
+
+	index = RelationIdGetRelation(state->indexOID);
+	sourcesTable = PGrnLookupSourcesTable(index, ERROR);
+	if (searcher)
+	{
+		PGrnCustomScanSearch(customScanState, index, sourcesTable);
+		PGrnCustomScanParallelPublish(customScanState);
+		if (state->searched)
+			grn_table_truncate(ctx, state->searched);
+	}
+	else
+	{
+		PGrnCustomScanParallelWait(customScanState);
+	}
+
+	if (state->parallelRecords)
+	{
+		if (!state->searched)
+			state->searched = PGrnCustomScanCreateSearched(sourcesTable);
+		PGrnCustomScanOpenCursor(
+			customScanState, sourcesTable, state->searched);
+		PGrnCustomScanParallelClaim(customScanState);
+	}
+	RelationClose(index);
+	state->opened = true;
+}
+
+/*
+ * Whether all target list entries can be computed without heap tuples.
+ * If so, we can use the visibility map to skip heap visits like index
+ * only scan.
+ */
+static bool
+PGrnCustomScanIsIndexOnly(CustomScanState *customScanState)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+
+	for (int i = 0; i < state->nTargets; i++)
+	{
+		switch (state->targets[i].type)
+		{
+		case PGRN_SCAN_TARGET_INDEX_COLUMN:
+		case PGRN_SCAN_TARGET_SCORE:
+			break;
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+static void
+PGrnInitBatch(CustomScanState *customScanState)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+
+	PGrnCtidCheckerInit(&(state->ctidChecker),
+						customScanState->ss.ss_currentRelation,
+						customScanState->ss.ps.state->es_snapshot,
+						PGrnCustomScanIsIndexOnly(customScanState));
+	state->batchIDs = palloc(sizeof(grn_id) * PGRN_SCAN_BATCH_MAX_SIZE);
+	state->batchCtids =
+		palloc(sizeof(ItemPointerData) * PGRN_SCAN_BATCH_MAX_SIZE);
+	state->batchAlives = palloc(sizeof(bool) * PGRN_SCAN_BATCH_MAX_SIZE);
+	if (state->heapSlot)
+	{
+		state->batchTuples =
+			palloc(sizeof(HeapTuple) * PGRN_SCAN_BATCH_MAX_SIZE);
+		state->batchMemoryContext =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "PGroonga custom scan batch",
+								  ALLOCSET_DEFAULT_SIZES);
+	}
+	state->batchSize = PGRN_SCAN_BATCH_MIN_SIZE;
+	state->nBatchRecords = 0;
+	state->batchPosition = 0;
+}
+
+static void
+PGrnBeginCustomScan(CustomScanState *customScanState,
+					EState *estate,
+					int eflags)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	CustomScan *cscan = (CustomScan *) (customScanState->ss.ps.plan);
+
+	if (!PGrnCustomScanInitialized)
+		return;
+
+	PGrnInitTargets(customScanState);
+	PGrnInitBatch(customScanState);
+	state->valueExprStates =
+		ExecInitExprList(cscan->custom_exprs, &(customScanState->ss.ps));
+	state->statistics.enabled = (estate->es_instrument != 0);
+
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return;
+
+	// Parallel custom scan is opened in the first PGrnExecCustomScan()
+	// because the shared data isn't initialized yet.
+	if (customScanState->ss.ps.plan->parallel_aware)
+		return;
+
+	PGrnCustomScanOpen(customScanState);
+}
+
+/*
+ * Sorts more records when all sorted records are consumed but there are
+ * records that aren't sorted yet. It may happen when sorted records
+ * include dead tuples. This doubles the number of sorted records to keep
+ * the number of sorts small.
+ */
+static bool
+PGrnCustomScanSortMore(CustomScanState *customScanState)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	int offset = state->nSortedRecords;
+
+	if (!state->sorted)
+		return false;
+	if (offset >= (int) grn_table_size(ctx, state->searched))
+		return false;
+
+	PGrnCustomScanSort(customScanState, offset > 0 ? offset : -1);
+	grn_table_cursor_close(ctx, state->tableCursor);
+	state->tableCursor = grn_table_cursor_open(ctx,
+											   state->sorted,
+											   NULL,
+											   0,
+											   NULL,
+											   0,
+											   offset,
+											   -1,
+											   GRN_CURSOR_ASCENDING);
+	return true;
+}
+
+/*
+ * heapTuple is the visible heap tuple fetched by PGrnCtidCheckerCheck().
+ * It's NULL when heap tuples aren't needed.
+ */
+static TupleTableSlot *
 PGrnMakeTupleTableSlot(CustomScanState *customScanState,
 					   grn_id id,
-					   ItemPointerData ctid)
+					   HeapTuple heapTuple)
 {
 	PGrnScanState *state = (PGrnScanState *) customScanState;
-	Relation table = customScanState->ss.ss_currentRelation;
 	TupleTableSlot *slot = customScanState->ss.ps.ps_ResultTupleSlot;
 	ExprContext *econtext = customScanState->ss.ps.ps_ExprContext;
-	unsigned int ttsIndex = 0;
-	unsigned int varIndex = 0;
-	ListCell *cell;
 	ExecClearTuple(slot);
-	econtext->ecxt_scantuple = slot;
-	// We might add state->targetlist instead of ss.ps.plan->targetlist.
-	foreach (cell, customScanState->ss.ps.plan->targetlist)
+	// Expression targets refer the scanned tuple.
+	econtext->ecxt_scantuple = state->heapSlot;
+	if (state->heapSlot)
+		ExecStoreHeapTuple(heapTuple, state->heapSlot, false);
+	ResetExprContext(econtext);
+	for (int i = 0; i < state->nTargets; i++)
 	{
-		TargetEntry *entry = (TargetEntry *) lfirst(cell);
+		PGrnScanTarget *target = &(state->targets[i]);
 		GRN_BULK_REWIND(&(state->columnValue));
-		if (IsA(entry->expr, Var))
+		switch (target->type)
 		{
-			grn_obj *column = GRN_PTR_VALUE_AT(&(state->columns), varIndex);
-			varIndex++;
-			if (column)
-			{
-				Oid typeID = exprType((Node *) (entry->expr));
-				grn_obj_get_value(ctx, column, id, &(state->columnValue));
-				slot->tts_values[ttsIndex] =
-					PGrnConvertToDatum(&(state->columnValue), typeID);
-				// todo
-				// If there are nullable columns, do not custom scan.
-				// See also
-				// https://github.com/pgroonga/pgroonga/pull/742#discussion_r2107937927
-				slot->tts_isnull[ttsIndex] = false;
-			}
-			else
-			{
-				bool found = false;
-				TupleTableSlot *tupleSlot = MakeSingleTupleTableSlot(
-					RelationGetDescr(table), &TTSOpsBufferHeapTuple);
-				found = table_tuple_fetch_row_version(
-					table, &ctid, GetTransactionSnapshot(), tupleSlot);
-				if (found)
-				{
-					Var *var = (Var *) entry->expr;
-					bool isnull = false;
-					slot->tts_values[ttsIndex] =
-						slot_getattr(tupleSlot, var->varattno, &isnull);
-					slot->tts_isnull[ttsIndex] = isnull;
-				}
-				else
-				{
-					slot->tts_values[ttsIndex] = 0;
-					slot->tts_isnull[ttsIndex] = true;
-				}
-				ExecDropSingleTupleTableSlot(tupleSlot);
-			}
+		case PGRN_SCAN_TARGET_INDEX_COLUMN:
+			grn_obj_get_value(ctx, target->column, id, &(state->columnValue));
+			slot->tts_values[i] =
+				PGrnConvertToDatum(&(state->columnValue), target->typeID);
+			// todo
+			// If there are nullable columns, do not custom scan.
+			// See also
+			// https://github.com/pgroonga/pgroonga/pull/742#discussion_r2107937927
+			slot->tts_isnull[i] = false;
+			break;
+		case PGRN_SCAN_TARGET_HEAP_COLUMN:
+		{
+			bool isnull = false;
+			slot->tts_values[i] = slot_getattr(
+				state->heapSlot, target->attributeNumber, &isnull);
+			slot->tts_isnull[i] = isnull;
+			break;
 		}
-		else if (IsA(entry->expr, FuncExpr))
+		case PGRN_SCAN_TARGET_SCORE:
+			grn_obj_get_value(
+				ctx, state->scoreAccessor, id, &(state->columnValue));
+			slot->tts_values[i] =
+				PGrnConvertToDatum(&(state->columnValue), FLOAT8OID);
+			slot->tts_isnull[i] = false;
+			break;
+		case PGRN_SCAN_TARGET_EXPRESSION:
 		{
-			FuncExpr *funcExpr = (FuncExpr *) (entry->expr);
-			if (strcmp(get_func_name(funcExpr->funcid), "pgroonga_score") == 0)
-			{
-				// todo
-				// Reject this function if the argument isn't
-				// `(tableoid, ctid)` nor `(record)`.
-				grn_obj_get_value(
-					ctx, state->scoreAccessor, id, &(state->columnValue));
-				slot->tts_values[ttsIndex] =
-					PGrnConvertToDatum(&(state->columnValue), FLOAT8OID);
-				slot->tts_isnull[ttsIndex] = false;
-			}
-			else
-			{
-				// todo
-				// Initialization in BeginCustomScan.
-				// See also
-				// https://github.com/pgroonga/pgroonga/pull/783/files#r2374165154
-				ExprState *state = ExecInitExpr((Expr *) funcExpr, NULL);
-				bool isNull = false;
-				ResetExprContext(econtext);
-				slot->tts_values[ttsIndex] =
-					ExecEvalExpr(state, econtext, &isNull);
-				slot->tts_isnull[ttsIndex] = isNull;
-			}
+			bool isNull = false;
+			slot->tts_values[i] =
+				ExecEvalExpr(target->exprState, econtext, &isNull);
+			slot->tts_isnull[i] = isNull;
+			break;
+		}
+		default:
+			break;
 		}
-		ttsIndex++;
 	}
 	return ExecStoreVirtualTuple(slot);
 }
 
+/*
+ * Reads the next records from the cursor and checks their ctids in heap
+ * order. This returns false when there are no more records.
+ *
+ * This doesn't read records over the current cursor. Because
+ * PGrnCustomScanParallelClaim() truncates the current records.
+ */
+static bool
+PGrnCustomScanFillBatch(CustomScanState *customScanState)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	uint32 n = 0;
+	uint32 nHeapFetches;
+
+	state->nBatchRecords = 0;
+	state->batchPosition = 0;
+	while (n < state->batchSize)
+	{
+		grn_id id = grn_table_cursor_next(ctx, state->tableCursor);
+		if (id == GRN_ID_NIL)
+		{
+			if (n > 0)
+				break;
+			if (PGrnCustomScanSortMore(customScanState))
+				continue;
+			if (state->parallelRecords &&
+				PGrnCustomScanParallelClaim(customScanState))
+				continue;
+			return false;
+		}
+
+		GRN_BULK_REWIND(&(state->columnValue));
+		grn_obj_get_value(ctx, state->ctidAccessor, id, &(state->columnValue));
+		state->batchIDs[n] = id;
+		state->batchCtids[n] =
+			PGrnCtidUnpack(GRN_UINT64_VALUE(&(state->columnValue)));
+		n++;
+	}
+
+	if (state->batchMemoryContext)
+	{
+		MemoryContext oldMemoryContext;
+
+		// The previous heap tuples are freed.
+		ExecClearTuple(state->heapSlot);
+		MemoryContextReset(state->batchMemoryContext);
+		oldMemoryContext = MemoryContextSwitchTo(state->batchMemoryContext);
+		nHeapFetches = PGrnCtidCheckerCheck(&(state->ctidChecker),
+											state->batchCtids,
+											state->batchAlives,
+											state->batchTuples,
+											n);
+		MemoryContextSwitchTo(oldMemoryContext);
+	}
+	else
+	{
+		nHeapFetches = PGrnCtidCheckerCheck(&(state->ctidChecker),
+											state->batchCtids,
+											state->batchAlives,
+											NULL,
+											n);
+	}
+	state->statistics.nVisibilityChecks += n;
+	state->statistics.nHeapFetches += nHeapFetches;
+	state->nBatchRecords = n;
+	if (state->batchSize < PGRN_SCAN_BATCH_MAX_SIZE)
+		state->batchSize *= 2;
+	return true;
+}
+
 static TupleTableSlot *
 PGrnExecCustomScan(CustomScanState *customScanState)
 {
 	const char *tag = "pgroonga: [custom-scan][exec]";
 	PGrnScanState *state;
 	Relation table;
-	ItemPointerData ctid;
-	grn_id id;
-	uint64_t packedCtid;
 
 	if (!PGrnCustomScanInitialized)
 		return NULL;
 
 	state = (PGrnScanState *) customScanState;
+	if (!state->opened)
+	{
+		if (state->parallelShared)
+			PGrnCustomScanParallelOpen(customScanState);
+		else
+			PGrnCustomScanOpen(customScanState);
+	}
 	if (!state->tableCursor)
 		return NULL;
 
 	table = customScanState->ss.ss_currentRelation;
 	while (true)
 	{
-		id = grn_table_cursor_next(ctx, state->tableCursor);
-		if (id == GRN_ID_NIL)
-			return NULL;
+		uint32 i;
+		ItemPointer ctid;
 
-		GRN_BULK_REWIND(&(state->columnValue));
-		grn_obj_get_value(ctx, state->ctidAccessor, id, &(state->columnValue));
-		packedCtid = GRN_UINT64_VALUE(&(state->columnValue));
-		ctid = PGrnCtidUnpack(packedCtid);
-		if (!PGrnCtidIsAlive(table, &ctid))
+		if (state->batchPosition == state->nBatchRecords)
+		{
+			if (!PGrnCustomScanFillBatch(customScanState))
+				return NULL;
+		}
+
+		i = state->batchPosition++;
+		ctid = &(state->batchCtids[i]);
+		if (!state->batchAlives[i])
 		{
+			state->statistics.nDeadHits++;
 			GRN_LOG(ctx,
 					GRN_LOG_DEBUG,
 					"%s[dead] <%s>: <(%u,%u),%u>",
 					tag,
 					table->rd_rel->relname.data,
-					ctid.ip_blkid.bi_hi,
-					ctid.ip_blkid.bi_lo,
-					ctid.ip_posid);
+					ctid->ip_blkid.bi_hi,
+					ctid->ip_blkid.bi_lo,
+					ctid->ip_posid);
 			continue;
 		}
-		return PGrnMakeTupleTableSlot(customScanState, id, ctid);
+		return PGrnMakeTupleTableSlot(
+			customScanState,
+			state->batchIDs[i],
+			state->batchTuples ? state->batchTuples[i] : NULL);
 	}
 	return NULL;
 }
 
+/*
+ * The chosen index is shown with VERBOSE or ANALYZE. Statistics of
+ * Groonga are shown with ANALYZE.
+ */
 static void
 PGrnExplainCustomScan(CustomScanState *customScanState,
 					  List *ancestors,
 					  ExplainState *es)
 {
-	// todo Add the necessary information when we find it.
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	PGrnScanStatistics *statistics = &(state->statistics);
+
+	if (!PGrnCustomScanInitialized)
+		return;
+
+	if (!(es->verbose || es->analyze))
+		return;
+
+	ExplainPropertyText("PGroonga Index", get_rel_name(state->indexOID), es);
+
+	if (!(es->analyze && statistics->enabled))
+		return;
+
+	if (GRN_TEXT_LEN(&(statistics->expression)) > 0)
+	{
+		ExplainPropertyText("Groonga Expression",
+							pnstrdup(GRN_TEXT_VALUE(&(statistics->expression)),
+									 GRN_TEXT_LEN(&(statistics->expression))),
+							es);
+	}
+	ExplainPropertyInteger(
+		"Groonga Estimated Hits", NULL, statistics->nEstimatedHits, es);
+	ExplainPropertyInteger("Groonga Hits", NULL, statistics->nHits, es);
+	ExplainPropertyBool("Groonga Match Escalation (estimated)",
+						statistics->matchEscalated,
+						es);
+	if (es->timing)
+	{
+		ExplainPropertyFloat("Groonga Select Time",
+							 "ms",
+							 INSTR_TIME_GET_MILLISEC(statistics->selectTime),
+							 3,
+							 es);
+		if (state->pathKeys)
+		{
+			ExplainPropertyFloat("Groonga Sort Time",
+								 "ms",
+								 INSTR_TIME_GET_MILLISEC(statistics->sortTime),
+								 3,
+								 es);
+		}
+	}
+	ExplainPropertyInteger(
+		"Visibility Checks", NULL, statistics->nVisibilityChecks, es);
+	ExplainPropertyInteger("Heap Fetches", NULL, statistics->nHeapFetches, es);
+	ExplainPropertyInteger("Dead Hits", NULL, statistics->nDeadHits, es);
 }
 
 static void
 PGrnEndCustomScan(CustomScanState *customScanState)
 {
 	PGrnScanState *state = (PGrnScanState *) customScanState;
-	unsigned int nTargetColumns;
 
 	if (!PGrnCustomScanInitialized)
 		return;
@@ -924,20 +2111,58 @@ PGrnEndCustomScan(CustomScanState *customScanState)
 	state->indexOID = InvalidOid;
 	state->scanKeySources = NIL;
 	state->pathKeys = NIL;
+	state->limit = 0;
+	state->nSortedRecords = 0;
+	state->valueExprStates = NIL;
+	state->opened = false;
+	state->parallelShared = NULL;
+	GRN_OBJ_FIN(ctx, &(state->statistics.expression));
+
+	if (state->batchIDs)
+	{
+		PGrnCtidCheckerFin(&(state->ctidChecker));
+		pfree(state->batchIDs);
+		state->batchIDs = NULL;
+		pfree(state->batchCtids);
+		state->batchCtids = NULL;
+		pfree(state->batchAlives);
+		state->batchAlives = NULL;
+	}
+	if (state->batchTuples)
+	{
+		ExecClearTuple(state->heapSlot);
+		pfree(state->batchTuples);
+		state->batchTuples = NULL;
+		MemoryContextDelete(state->batchMemoryContext);
+		state->batchMemoryContext = NULL;
+	}
+	state->batchSize = 0;
+	state->nBatchRecords = 0;
+	state->batchPosition = 0;
 
 	if (state->tableCursor)
 	{
 		grn_table_cursor_close(ctx, state->tableCursor);
 		state->tableCursor = NULL;
 	}
-	nTargetColumns = GRN_PTR_VECTOR_SIZE(&(state->columns));
-	for (unsigned int i = 0; i < nTargetColumns; i++)
+	for (int i = 0; i < state->nTargets; i++)
+	{
+		PGrnScanTarget *target = &(state->targets[i]);
+		if (target->column)
+			grn_obj_unlink(ctx, target->column);
+	}
+	if (state->targets)
+	{
+		pfree(state->targets);
+		state->targets = NULL;
+	}
+	state->nTargets = 0;
+	if (state->heapSlot)
 	{
-		grn_obj *column = GRN_PTR_VALUE_AT(&(state->columns), i);
-		grn_obj_unlink(ctx, column);
+		ExecDropSingleTupleTableSlot(state->heapSlot);
+		state->heapSlot = NULL;
 	}
 	GRN_OBJ_FIN(ctx, &(state->columnValue));
-	GRN_OBJ_FIN(ctx, &(state->columns));
 
 	if (state->searchData.index)
 	{
@@ -964,18 +2189,146 @@ PGrnEndCustomScan(CustomScanState *customScanState)
 		grn_obj_close(ctx, state->searched);
 		state->searched = NULL;
 	}
+	state->parallelRecords = NULL;
 }
 
+/*
+ * Clears only the search result. The next PGrnExecCustomScan() searches
+ * again with the current parameters. The sources table, the result
+ * tables, target columns and accessors are reused.
+ */
 static void
 PGrnReScanCustomScan(CustomScanState *customScanState)
 {
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+
+	if (!PGrnCustomScanInitialized)
+		return;
+
+	if (state->tableCursor)
+	{
+		grn_table_cursor_close(ctx, state->tableCursor);
+		state->tableCursor = NULL;
+	}
+	if (state->sorted)
+		grn_table_truncate(ctx, state->sorted);
+	if (state->searched)
+		grn_table_truncate(ctx, state->searched);
+	state->nSortedRecords = 0;
+
+	state->batchSize = PGRN_SCAN_BATCH_MIN_SIZE;
+	state->nBatchRecords = 0;
+	state->batchPosition = 0;
+
+	// PGrnReInitializeDSMCustomScan() resets the shared data.
+	state->parallelRecords = NULL;
+
+	state->opened = false;
+}
+
+/*
+ * Adds statistics of this worker to the shared statistics.
+ */
+static void
+PGrnCustomScanParallelAddStatistics(CustomScanState *customScanState)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	PGrnScanStatistics *statistics = &(state->statistics);
+	PGrnScanParallelSharedData *shared = state->parallelShared;
+	PGrnScanParallelStatistics *sharedStatistics = &(shared->statistics);
+	grn_obj *expression = &(statistics->expression);
+
+	SpinLockAcquire(&(shared->mutex));
+	if (GRN_TEXT_LEN(expression) > 0)
+	{
+		size_t size = Min(GRN_TEXT_LEN(expression),
+						  PGRN_SCAN_PARALLEL_EXPRESSION_SIZE - 1);
+		memcpy(sharedStatistics->expression, GRN_TEXT_VALUE(expression), size);
+		sharedStatistics->expression[size] = '\0';
+	}
+	sharedStatistics->nEstimatedHits += statistics->nEstimatedHits;
+	sharedStatistics->nHits += statistics->nHits;
+	INSTR_TIME_ADD(sharedStatistics->selectTime, statistics->selectTime);
+	INSTR_TIME_ADD(sharedStatistics->sortTime, statistics->sortTime);
+	sharedStatistics->nVisibilityChecks += statistics->nVisibilityChecks;
+	sharedStatistics->nHeapFetches += statistics->nHeapFetches;
+	sharedStatistics->nDeadHits += statistics->nDeadHits;
+	if (statistics->matchEscalated)
+		sharedStatistics->matchEscalated = true;
+	SpinLockRelease(&(shared->mutex));
+}
+
+/*
+ * Merges the shared statistics of workers into the statistics of the
+ * leader. The shared statistics are cleared to avoid merging them
+ * twice.
+ */
+static void
+PGrnCustomScanParallelMergeStatistics(CustomScanState *customScanState)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	PGrnScanStatistics *statistics = &(state->statistics);
+	PGrnScanParallelSharedData *shared = state->parallelShared;
+	PGrnScanParallelStatistics *sharedStatistics = &(shared->statistics);
+
+	if (!statistics->enabled)
+		return;
+
+	SpinLockAcquire(&(shared->mutex));
+	if (sharedStatistics->expression[0] != '\0')
+	{
+		GRN_TEXT_SETS(
+			ctx, &(statistics->expression), sharedStatistics->expression);
+	}
+	statistics->nEstimatedHits += sharedStatistics->nEstimatedHits;
+	statistics->nHits += sharedStatistics->nHits;
+	INSTR_TIME_ADD(statistics->selectTime, sharedStatistics->selectTime);
+	INSTR_TIME_ADD(statistics->sortTime, sharedStatistics->sortTime);
+	statistics->nVisibilityChecks += sharedStatistics->nVisibilityChecks;
+	statistics->nHeapFetches += sharedStatistics->nHeapFetches;
+	statistics->nDeadHits += sharedStatistics->nDeadHits;
+	if (sharedStatistics->matchEscalated)
+		statistics->matchEscalated = true;
+	memset(sharedStatistics, 0, sizeof(PGrnScanParallelStatistics));
+	SpinLockRelease(&(shared->mutex));
+}
+
+/*
+ * Workers share their statistics here because the DSM of the parallel
+ * query is destroyed before EXPLAIN ANALYZE shows statistics. The
+ * leader is shut down after all workers are finished unless the
+ * leader stops reading tuples such as with LIMIT.
+ */
+static void
+PGrnShutdownCustomScan(CustomScanState *customScanState)
+{
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+
+	if (!PGrnCustomScanInitialized)
+		return;
+
+	if (!state->parallelShared)
+		return;
+
+	if (IsParallelWorker())
+	{
+		if (state->statistics.enabled)
+			PGrnCustomScanParallelAddStatistics(customScanState);
+	}
+	else
+	{
+		PGrnCustomScanParallelMergeStatistics(customScanState);
+	}
+	// The DSM of the parallel query may be destroyed after this.
+	state->parallelShared = NULL;
+	state->parallelRecords = NULL;
 }
 
 static Size
 PGrnEstimateDSMCustomScan(CustomScanState *customScanState,
 						  ParallelContext *pcxt)
 {
-	return 0;
+	return sizeof(PGrnScanParallelSharedData);
 }
 
 static void
@@ -983,6 +2336,24 @@ PGrnInitializeDSMCustomScan(CustomScanState *customScanState,
 							ParallelContext *pcxt,
 							void *coordinate)
 {
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	PGrnScanParallelSharedData *shared =
+		(PGrnScanParallelSharedData *) coordinate;
+
+	/* If there is no DSA, there are no workers. This is executed as
+	 * a non parallel custom scan. */
+	if (!customScanState->ss.ps.state->es_query_dsa)
+		return;
+
+	SpinLockInit(&(shared->mutex));
+	shared->searching = false;
+	shared->published = false;
+	shared->records = InvalidDsaPointer;
+	shared->nRecords = 0;
+	pg_atomic_init_u64(&(shared->nextPosition), 0);
+	ConditionVariableInit(&(shared->conditionVariable));
+	memset(&(shared->statistics), 0, sizeof(shared->statistics));
+	state->parallelShared = shared;
 }
 
 static void
@@ -990,6 +2361,24 @@ PGrnReInitializeDSMCustomScan(CustomScanState *customScanState,
 							  ParallelContext *pcxt,
 							  void *coordinate)
 {
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	PGrnScanParallelSharedData *shared =
+		(PGrnScanParallelSharedData *) coordinate;
+	dsa_area *area = customScanState->ss.ps.state->es_query_dsa;
+
+	if (!area)
+		return;
+
+	state->parallelShared = shared;
+	// Workers of the previous scan are already finished.
+	PGrnCustomScanParallelMergeStatistics(customScanState);
+	if (DsaPointerIsValid(shared->records))
+		dsa_free(area, shared->records);
+	shared->searching = false;
+	shared->published = false;
+	shared->records = InvalidDsaPointer;
+	shared->nRecords = 0;
+	pg_atomic_write_u64(&(shared->nextPosition), 0);
 }
 
 static void
@@ -997,6 +2386,8 @@ PGrnInitializeWorkerCustomScan(CustomScanState *customScanState,
 							   shm_toc *toc,
 							   void *coordinate)
 {
+	PGrnScanState *state = (PGrnScanState *) customScanState;
+	state->parallelShared = (PGrnScanParallelSharedData *) coordinate;
 }
 
 void
@@ -6,6 +6,7 @@
 
 struct PGrnBuffers PGrnBuffers;
 int PGrnMatchEscalationThreshold = 0;
+bool PGrnForceMatchEscalation = false;
 
 void
 PGrnInitializeBuffers(void)
@@ -42,6 +42,7 @@ struct PGrnBuffers
 
 extern struct PGrnBuffers PGrnBuffers;
 extern int PGrnMatchEscalationThreshold;
+extern bool PGrnForceMatchEscalation;
 
 void PGrnInitializeBuffers(void);
 void PGrnFinalizeBuffers(void);
@@ -4,6 +4,7 @@
 #include "pgrn-convert.h"
 #include "pgrn-global.h"
 #include "pgrn-groonga.h"
+#include "pgrn-index-cache.h"
 #include "pgrn-pg.h"
 #include "pgrn-wal.h"
 
@@ -442,6 +443,7 @@ PGrnRemoveObjectWithSize(const char *name, size_t nameSize)
 	grn_obj *object;
 
 	object = PGrnLookupWithSize(name, nameSize, ERROR);
+	PGrnIndexCacheInvalidate();
 	grn_obj_remove(ctx, object);
 	PGrnCheck("failed to remove: <%.*s>", (int) nameSize, name);
 }
@@ -457,6 +459,7 @@ PGrnRemoveObjectForceWithSize(Relation index, const char *name, size_t nameSize)
 {
 	grn_obj *object;
 
+	PGrnIndexCacheInvalidate();
 	object = PGrnLookupWithSize(name, nameSize, PGRN_ERROR_LEVEL_IGNORE);
 	if (object)
 	{
@@ -513,6 +516,7 @@ PGrnRemoveColumns(Relation index, grn_obj *table)
 	PGrnCheck("failed to collect columns for removing columns: <%s>",
 			  PGrnInspectName(table));
 
+	PGrnIndexCacheInvalidate();
 	GRN_HASH_EACH_BEGIN(ctx, columns, cursor, id)
 	{
 		grn_id *columnID;
@@ -538,6 +542,66 @@ PGrnRemoveColumns(Relation index, grn_obj *table)
 	grn_hash_close(ctx, columns);
 }
 
+/*
+ * Collects IDs of Groonga objects for the index that has the nodeID
+ * relfilenode into ids (a GRN_ID vector). Columns are included.
+ */
+void
+PGrnCollectIndexObjectIDs(Oid nodeID, grn_obj *ids)
+{
+	const char *prefixes[] = {
+		PGrnLexiconNamePrefix "%u_",
+		PGrnJSONValueLexiconNamePrefix "FullTextSearch%u_",
+		PGrnJSONValueLexiconNamePrefix "String%u_",
+		PGrnJSONValueLexiconNamePrefix "Number%u_",
+		PGrnJSONValueLexiconNamePrefix "Boolean%u_",
+		PGrnJSONValueLexiconNamePrefix "Size%u_",
+		PGrnJSONTypesTableNamePrefix "%u_",
+		PGrnJSONValuesTableNamePrefix "%u_",
+		PGrnJSONPathsTableNamePrefix "%u_",
+		PGrnBuildingSourcesTableNamePrefix "%u",
+		PGrnSourcesTableNamePrefix "%u",
+	};
+	size_t i;
+	const size_t nPrefixes = sizeof(prefixes) / sizeof(*prefixes);
+	grn_obj *db;
+
+	db = grn_ctx_db(ctx);
+	for (i = 0; i < nPrefixes; i++)
+	{
+		char prefix[GRN_TABLE_MAX_KEY_SIZE];
+		size_t prefixSize;
+		bool needDelimiterCheck;
+
+		snprintf(prefix, sizeof(prefix), prefixes[i], nodeID);
+		prefixSize = strlen(prefix);
+		/* "Sources1" must not match "Sources12". */
+		needDelimiterCheck = (prefix[prefixSize - 1] != '_');
+		GRN_TABLE_EACH_BEGIN_MIN(ctx,
+								 db,
+								 cursor,
+								 id,
+								 prefix,
+								 prefixSize,
+								 GRN_CURSOR_PREFIX | GRN_CURSOR_DESCENDING)
+		{
+			if (needDelimiterCheck)
+			{
+				void *key;
+				const char *name;
+				int nameSize;
+
+				nameSize = grn_table_cursor_get_key(ctx, cursor, &key);
+				name = key;
+				if (nameSize > (int) prefixSize && name[prefixSize] != '.')
+					continue;
+			}
+			GRN_RECORD_PUT(ctx, ids, id);
+		}
+		GRN_TABLE_EACH_END(ctx, cursor);
+	}
+}
+
 grn_id
 PGrnPGTypeToGrnType(Oid pgTypeID, unsigned char *flags)
 {
@@ -376,6 +376,7 @@ void PGrnRemoveObjectForceWithSize(Relation index,
 								   size_t nameSize);
 
 void PGrnRemoveColumns(Relation index, grn_obj *table);
+void PGrnCollectIndexObjectIDs(Oid nodeID, grn_obj *ids);
 
 void PGrnFlushObject(grn_obj *object, bool recursive);
 
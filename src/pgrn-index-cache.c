@@ -0,0 +1,164 @@
+#include "pgroonga.h"
+
+#include "pgrn-compatible.h"
+#include "pgrn-groonga.h"
+#include "pgrn-index-cache.h"
+
+#include <utils/inval.h>
+
+/*
+ * Backend local cache of Groonga objects for an index. This is keyed
+ * by the relfilenode of the index. This is used to avoid looking up
+ * Groonga objects by name for each inserted record.
+ *
+ * Cached grn_objs may be closed or removed by the followings. So we
+ * invalidate all entries on them:
+ *
+ *   * PGrnUnmapDB() after VACUUM
+ *   * Removing a Groonga object
+ *   * Relcache invalidation for all relations
+ *
+ * Relcache invalidation for a relation invalidates only the entry of
+ * the relation.
+ *
+ * Invalidated entries are removed or refreshed on the next
+ * PGrnIndexCacheGet() call. We don't remove them in
+ * PGrnIndexCacheInvalidate() because relcache invalidation may be
+ * processed while an entry is used.
+ */
+static grn_hash *indexCaches = NULL;
+static bool indexCachesInvalidated = false;
+static bool relcacheCallbackRegistered = false;
+
+static void
+PGrnIndexCacheInvalidateRelcache(Datum arg, Oid relationID)
+{
+	if (!OidIsValid(relationID))
+	{
+		PGrnIndexCacheInvalidate();
+		return;
+	}
+
+	if (!indexCaches || indexCachesInvalidated)
+		return;
+
+	GRN_HASH_EACH_BEGIN(ctx, indexCaches, cursor, id)
+	{
+		void *value;
+		PGrnIndexCacheData *data;
+		grn_hash_cursor_get_value(ctx, cursor, &value);
+		data = value;
+		if (data->indexOID == relationID)
+			data->invalidated = true;
+	}
+	GRN_HASH_EACH_END(ctx, cursor);
+}
+
+void
+PGrnInitializeIndexCache(void)
+{
+	indexCaches = grn_hash_create(ctx,
+								  NULL,
+								  sizeof(PGrnRelFileNumber),
+								  sizeof(PGrnIndexCacheData),
+								  GRN_OBJ_TABLE_HASH_KEY);
+	if (!relcacheCallbackRegistered)
+	{
+		CacheRegisterRelcacheCallback(PGrnIndexCacheInvalidateRelcache,
+									  (Datum) 0);
+		relcacheCallbackRegistered = true;
+	}
+}
+
+void
+PGrnFinalizeIndexCache(void)
+{
+	if (indexCaches)
+	{
+		grn_hash_close(ctx, indexCaches);
+		indexCaches = NULL;
+	}
+	indexCachesInvalidated = false;
+}
+
+void
+PGrnIndexCacheInvalidate(void)
+{
+	indexCachesInvalidated = true;
+}
+
+PGrnIndexCacheData *
+PGrnIndexCacheGet(Relation index)
+{
+	PGrnRelFileNumber fileNumber = PGRN_RELATION_GET_LOCATOR_NUMBER(index);
+	PGrnIndexCacheData *data;
+	void *value;
+	int added = 0;
+	grn_id id;
+
+	if (!indexCaches)
+		return NULL;
+
+	if (indexCachesInvalidated)
+	{
+		if (grn_hash_size(ctx, indexCaches) > 0)
+			grn_hash_truncate(ctx, indexCaches);
+		indexCachesInvalidated = false;
+	}
+
+	id = grn_hash_add(
+		ctx, indexCaches, &fileNumber, sizeof(fileNumber), &value, &added);
+	if (id == GRN_ID_NIL)
+		return NULL;
+
+	data = value;
+	if (!added && !data->invalidated)
+		return data;
+
+	data->indexOID = RelationGetRelid(index);
+	data->invalidated = false;
+	PG_TRY();
+	{
+		data->sourcesTable = PGrnLookupSourcesTable(index, ERROR);
+		if (data->sourcesTable->header.type == GRN_TABLE_NO_KEY)
+		{
+			data->sourcesCtidColumn = PGrnLookupSourcesCtidColumn(index, ERROR);
+		}
+		else
+		{
+			data->sourcesCtidColumn = NULL;
+		}
+	}
+	PG_CATCH();
+	{
+		grn_hash_delete_by_id(ctx, indexCaches, id, NULL);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	data->nIndexPages = -1;
+	memset(data->columns, 0, sizeof(data->columns));
+
+	return data;
+}
+
+PGrnIndexCacheColumn *
+PGrnIndexCacheGetColumn(PGrnIndexCacheData *data,
+						Relation index,
+						unsigned int nthAttribute)
+{
+	PGrnIndexCacheColumn *column = &(data->columns[nthAttribute]);
+
+	if (!column->column)
+	{
+		TupleDesc desc = RelationGetDescr(index);
+		Form_pg_attribute attribute = TupleDescAttr(desc, nthAttribute);
+
+		column->column = PGrnLookupColumn(
+			data->sourcesTable, attribute->attname.data, ERROR);
+		column->rawDomain =
+			PGrnPGTypeToGrnType(attribute->atttypid, &(column->flags));
+		column->domain = grn_obj_get_range(ctx, column->column);
+	}
+
+	return column;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <postgres.h>
+#include <utils/rel.h>
+
+#include <groonga.h>
+
+typedef struct PGrnIndexCacheColumn
+{
+	grn_obj *column;
+	grn_id rawDomain;
+	unsigned char flags;
+	grn_id domain;
+} PGrnIndexCacheColumn;
+
+typedef struct PGrnIndexCacheData
+{
+	Oid indexOID;
+	bool invalidated;
+	grn_obj *sourcesTable;
+	grn_obj *sourcesCtidColumn;
+	/* Negative value means that this isn't computed yet. */
+	double nIndexPages;
+	PGrnIndexCacheColumn columns[INDEX_MAX_KEYS];
+} PGrnIndexCacheData;
+
+void PGrnInitializeIndexCache(void);
+void PGrnFinalizeIndexCache(void);
+void PGrnIndexCacheInvalidate(void);
+PGrnIndexCacheData *PGrnIndexCacheGet(Relation index);
+PGrnIndexCacheColumn *PGrnIndexCacheGetColumn(PGrnIndexCacheData *data,
+											  Relation index,
+											  unsigned int nthAttribute);
@@ -30,6 +30,7 @@ typedef struct PGrnOptions
 	int normalizersMappingOffset;
 	int indexFlagsMappingOffset;
 	int modelOffset;
+	int buildThreads;
 } PGrnOptions;
 
 static relopt_kind PGrnReloptionKind;
@@ -551,6 +552,14 @@ PGrnInitializeOptions(void)
 						 NULL,
 						 PGrnOptionValidateModel,
 						 lock_mode);
+	add_int_reloption(PGrnReloptionKind,
+					  "build_threads",
+					  "The number of threads to be used by "
+					  "static index construction",
+					  0,
+					  0,
+					  PGRN_MAX_BUILD_THREADS,
+					  lock_mode);
 }
 
 void
@@ -932,6 +941,18 @@ PGrnOptionsGetExprParseFlags(Relation index)
 	return flags;
 }
 
+int
+PGrnOptionsGetBuildThreads(Relation index)
+{
+	PGrnOptions *options;
+
+	options = (PGrnOptions *) (index->rd_options);
+	if (!options)
+		return 0;
+
+	return options->buildThreads;
+}
+
 bytea *
 pgroonga_options(Datum reloptions, bool validate)
 {
@@ -975,6 +996,9 @@ pgroonga_options(Datum reloptions, bool validate)
 		 RELOPT_TYPE_STRING,
 		 offsetof(PGrnOptions, indexFlagsMappingOffset)},
 		{"model", RELOPT_TYPE_STRING, offsetof(PGrnOptions, modelOffset)},
+		{"build_threads",
+		 RELOPT_TYPE_INT,
+		 offsetof(PGrnOptions, buildThreads)},
 	};
 
 	grnOptions = build_reloptions(reloptions,
@@ -5,6 +5,8 @@
 #include <postgres.h>
 #include <utils/rel.h>
 
+#define PGRN_MAX_BUILD_THREADS 1024
+
 typedef enum
 {
 	PGRN_OPTION_USE_CASE_UNKNOWN,
@@ -36,5 +38,6 @@ void PGrnResolveOptionValues(Relation index,
 							 PGrnResolvedOptions *resolvedOptions);
 
 grn_expr_flags PGrnOptionsGetExprParseFlags(Relation index);
+int PGrnOptionsGetBuildThreads(Relation index);
 
 bytea *pgroonga_options(Datum reloptions, bool validate);
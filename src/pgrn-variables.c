@@ -5,6 +5,7 @@
 #include "pgrn-global.h"
 #include "pgrn-groonga.h"
 #include "pgrn-log-level.h"
+#include "pgrn-options.h"
 #include "pgrn-row-level-security.h"
 #include "pgrn-trace-log.h"
 #include "pgrn-value.h"
@@ -15,6 +16,7 @@
 
 #include <groonga.h>
 
+#include <float.h>
 #include <limits.h>
 
 static int PGrnLogType;
@@ -41,11 +43,12 @@ static int PGrnLockTimeout;
 
 static bool PGrnEnableWAL;
 static int PGrnMaxWALSizeKB;
+static bool PGrnEnableWALGroupCommit;
+static int PGrnWALAppliedPositionUpdateInterval;
+static int PGrnMaxWALApplyDelay;
 
 static bool PGrnEnableCrashSafe;
 
-static bool PGrnForceMatchEscalation;
-
 static char *PGrnLibgroongaVersion;
 
 static bool PGrnEnableWALResourceManager;
@@ -262,6 +265,31 @@ PGrnMaxWALSizeAssign(int new_value, void *extra)
 	PGrnWALSetMaxSize(new_value * 1024);
 }
 
+static void
+PGrnEnableWALGroupCommitAssign(bool new_value, void *extra)
+{
+	if (new_value)
+	{
+		PGrnWALGroupCommitEnable();
+	}
+	else
+	{
+		PGrnWALGroupCommitDisable();
+	}
+}
+
+static void
+PGrnWALAppliedPositionUpdateIntervalAssign(int new_value, void *extra)
+{
+	PGrnWALSetAppliedPositionUpdateInterval(new_value);
+}
+
+static void
+PGrnMaxWALApplyDelayAssign(int new_value, void *extra)
+{
+	PGrnWALSetMaxApplyDelay(new_value);
+}
+
 static void
 PGrnMatchEscalationThresholdAssignRaw(int new_value)
 {
@@ -468,6 +496,69 @@ PGrnInitializeVariables(void)
 							PGrnMaxWALSizeAssign,
 							NULL);
 
+	DefineCustomBoolVariable("pgroonga.enable_wal_group_commit",
+							 "Enable group commit for WAL.",
+							 "Concurrent writers for the same index share "
+							 "one WAL record. It improves write throughput "
+							 "when many sessions update the same index. "
+							 "This is used only when pgroonga.enable_wal "
+							 "is on. The default is off.",
+							 &PGrnEnableWALGroupCommit,
+							 PGrnWALGroupCommitGetEnabled(),
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 PGrnEnableWALGroupCommitAssign,
+							 NULL);
+
+	DefineCustomIntVariable("pgroonga.wal_applied_position_update_interval",
+							"The number of applied WAL records to update "
+							"the applied WAL position.",
+							"The applied WAL position is updated after "
+							"this number of WAL records are applied, at "
+							"the end of each WAL page and after each WAL "
+							"record that can't be applied twice. "
+							"Records applied after the last update are "
+							"applied again when applying is failed. "
+							"The default is 100. "
+							"If you use 1, the position is updated after "
+							"each WAL record.",
+							&PGrnWALAppliedPositionUpdateInterval,
+							PGrnWALGetAppliedPositionUpdateInterval(),
+							1,
+							INT_MAX,
+							PGC_USERSET,
+							0,
+							NULL,
+							PGrnWALAppliedPositionUpdateIntervalAssign,
+							NULL);
+
+	DefineCustomIntVariable("pgroonga.max_wal_apply_delay",
+							"Max delay of applying WAL on search in "
+							"milliseconds.",
+							"Search doesn't apply WAL when all WAL were "
+							"applied within this delay. "
+							"pgroonga_wal_applier or "
+							"pgroonga_standby_maintainer applies WAL "
+							"instead. Search that doesn't apply WAL "
+							"wakes pgroonga_wal_applier up for the database. "
+							"It's the only wake-up before the naptime. "
+							"Search results may not include "
+							"changes in this delay. "
+							"This should be larger than the naptime of "
+							"them. "
+							"The default is -1. "
+							"It means that search always applies WAL.",
+							&PGrnMaxWALApplyDelay,
+							PGrnWALGetMaxApplyDelay(),
+							-1,
+							INT_MAX,
+							PGC_USERSET,
+							GUC_UNIT_MS,
+							NULL,
+							PGrnMaxWALApplyDelayAssign,
+							NULL);
+
 	DefineCustomBoolVariable("pgroonga.enable_crash_safe",
 							 "Enable crash safe feature.",
 							 "You also need to add 'pgroonga_crash_safer' to "
@@ -587,11 +678,9 @@ PGrnInitializeVariables(void)
 
 	DefineCustomBoolVariable("pgroonga.enable_parallel_build_copy",
 							 "Enable parallel data copy in index build.",
-							 "It's disabled by default it's slow for now. "
-							 "We may enable it by default when it's faster. "
-							 "On the other hand, "
-							 "parallel index construction is always enabled "
-							 "because it's faster.",
+							 "It's enabled by default. "
+							 "Parallel index construction is always enabled "
+							 "regardless of this.",
 							 &PGrnEnableParallelBuildCopy,
 							 PGrnEnableParallelBuildCopy,
 							 PGC_USERSET,
@@ -600,6 +689,24 @@ PGrnInitializeVariables(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomIntVariable("pgroonga.build_threads",
+							"The number of threads for static index "
+							"construction.",
+							"Specifies the number of threads to be used by "
+							"static index construction. "
+							"This overrides build_threads index option. "
+							"0 (default) uses build_threads index option or "
+							"max_parallel_maintenance_workers.",
+							&PGrnBuildThreads,
+							PGrnBuildThreads,
+							0,
+							PGRN_MAX_BUILD_THREADS,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	DefineCustomBoolVariable("pgroonga.enable_custom_scan",
 							 "Enable custom scan.", // todo Add description.
 							 "Enable custom scan.", // todo Add description.
@@ -611,6 +718,41 @@ PGrnInitializeVariables(void)
 							 PGrnEnableCustomScanAssign,
 							 NULL);
 
+	DefineCustomRealVariable("pgroonga.posting_cost",
+							 "Planner's estimate of the cost of processing "
+							 "each posting in a search.",
+							 "Groonga processes all matched postings before "
+							 "PGroonga returns the first tuple. "
+							 "So this is used for the startup cost of "
+							 "PGroonga index scans. "
+							 "The default is the same as the default of "
+							 "cpu_operator_cost.",
+							 &PGrnPostingCost,
+							 PGrnPostingCost,
+							 0.0,
+							 DBL_MAX,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomRealVariable("pgroonga.default_selectivity",
+							 "Planner's estimate of the selectivity of "
+							 "a condition that Groonga can't estimate.",
+							 "This is used when Groonga can't estimate "
+							 "the number of matched records of a condition. "
+							 "The default is 0.01.",
+							 &PGrnDefaultSelectivity,
+							 PGrnDefaultSelectivity,
+							 0.0,
+							 1.0,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	EmitWarningsOnPlaceholders("pgroonga");
 }
 
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <c.h>
+#include <miscadmin.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <storage/spin.h>
+
+#include <signal.h>
+
+/*
+ * Databases that have pending PGroonga WAL. Processes that find
+ * pending WAL register their database and wake pgroonga_wal_applier
+ * up. pgroonga_wal_applier visits only registered databases until
+ * the next pgroonga_wal_applier.naptime.
+ *
+ * If too many databases are registered, overflowed is set. All
+ * databases are visited in this case.
+ */
+#define PGRN_WAL_APPLIER_STATUSES_N_DATABASES 64
+
+typedef struct pgrn_wal_applier_statuses
+{
+	slock_t mutex;
+	pid_t pid;
+	bool overflowed;
+	uint32 nDatabases;
+	Oid databaseOids[PGRN_WAL_APPLIER_STATUSES_N_DATABASES];
+} pgrn_wal_applier_statuses;
+
+static inline pgrn_wal_applier_statuses *
+pgrn_wal_applier_statuses_get(void)
+{
+	const char *name = "pgrn-wal-applier-statuses";
+	pgrn_wal_applier_statuses *statuses;
+	bool found;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	statuses =
+		ShmemInitStruct(name, sizeof(pgrn_wal_applier_statuses), &found);
+	if (!found)
+	{
+		SpinLockInit(&(statuses->mutex));
+		statuses->pid = InvalidPid;
+		statuses->overflowed = false;
+		statuses->nDatabases = 0;
+	}
+	LWLockRelease(AddinShmemInitLock);
+	return statuses;
+}
+
+static inline void
+pgrn_wal_applier_statuses_set_main_pid(pgrn_wal_applier_statuses *statuses,
+									   pid_t pid)
+{
+	SpinLockAcquire(&(statuses->mutex));
+	statuses->pid = pid;
+	SpinLockRelease(&(statuses->mutex));
+}
+
+/*
+ * Registers the database as a database that has pending WAL. The
+ * main pgroonga_wal_applier process is woken up only when the
+ * database isn't registered yet.
+ */
+static inline void
+pgrn_wal_applier_statuses_request(pgrn_wal_applier_statuses *statuses,
+								  Oid databaseOid)
+{
+	bool registered = false;
+	pid_t pid;
+	uint32 i;
+
+	SpinLockAcquire(&(statuses->mutex));
+	pid = statuses->pid;
+	if (statuses->overflowed)
+	{
+		registered = true;
+	}
+	else
+	{
+		for (i = 0; i < statuses->nDatabases; i++)
+		{
+			if (statuses->databaseOids[i] == databaseOid)
+			{
+				registered = true;
+				break;
+			}
+		}
+	}
+	if (!registered)
+	{
+		if (statuses->nDatabases < PGRN_WAL_APPLIER_STATUSES_N_DATABASES)
+			statuses->databaseOids[statuses->nDatabases++] = databaseOid;
+		else
+			statuses->overflowed = true;
+	}
+	SpinLockRelease(&(statuses->mutex));
+
+	if (!registered && pid != InvalidPid)
+		kill(pid, SIGUSR1);
+}
+
+static inline bool
+pgrn_wal_applier_statuses_is_requested(pgrn_wal_applier_statuses *statuses)
+{
+	bool requested;
+
+	SpinLockAcquire(&(statuses->mutex));
+	requested = (statuses->overflowed || statuses->nDatabases > 0);
+	SpinLockRelease(&(statuses->mutex));
+
+	return requested;
+}
+
+/*
+ * Moves registered databases to databaseOids. databaseOids must have
+ * PGRN_WAL_APPLIER_STATUSES_N_DATABASES elements. Returns false when
+ * registered databases are overflowed.
+ */
+static inline bool
+pgrn_wal_applier_statuses_take(pgrn_wal_applier_statuses *statuses,
+							   Oid *databaseOids,
+							   uint32 *nDatabases)
+{
+	bool overflowed;
+
+	SpinLockAcquire(&(statuses->mutex));
+	overflowed = statuses->overflowed;
+	*nDatabases = statuses->nDatabases;
+	memcpy(databaseOids,
+		   statuses->databaseOids,
+		   sizeof(Oid) * statuses->nDatabases);
+	statuses->overflowed = false;
+	statuses->nDatabases = 0;
+	SpinLockRelease(&(statuses->mutex));
+
+	return !overflowed;
+}
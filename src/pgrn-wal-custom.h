@@ -23,6 +23,7 @@
 #define PGRN_WAL_RECORD_REMOVE_OBJECT 0x70
 #define PGRN_WAL_RECORD_REGISTER_PLUGIN 0x80
 #define PGRN_WAL_RECORD_BULK_INSERT 0x90
+#define PGRN_WAL_RECORD_BULK_DELETE 0xA0
 
 #define PGRN_WAL_RECORD_DOMAIN_ID_MASK GRN_ID_MAX
 #define PGRN_WAL_RECORD_DOMAIN_FLAGS_MASK 0xc0000000
@@ -1256,3 +1257,72 @@ PGrnWALRecordBulkInsertReadNext(PGrnWALRecordBulkInsert *record,
 	}
 	return true;
 }
+
+typedef struct PGrnWALRecordBulkDelete
+{
+	/* PGrnWALRecordCommon */
+	Oid dbID;
+	int dbEncoding;
+	Oid dbTableSpaceID;
+
+	const char *tableName;
+	uint32 tableNameSize;
+	uint32 nKeys;
+	const uint64_t *keys;
+} PGrnWALRecordBulkDelete;
+
+static inline void
+PGrnWALRecordBulkDeleteFill(PGrnWALRecordBulkDelete *record,
+							Oid dbID,
+							int dbEncoding,
+							Oid dbTableSpaceID,
+							const char *tableName,
+							uint32 tableNameSize,
+							uint32 nKeys,
+							const uint64_t *keys)
+{
+	record->dbID = dbID;
+	record->dbEncoding = dbEncoding;
+	record->dbTableSpaceID = dbTableSpaceID;
+	record->tableName = tableName;
+	record->tableNameSize = tableNameSize;
+	record->nKeys = nKeys;
+	record->keys = keys;
+}
+
+static inline void
+PGrnWALRecordBulkDeleteWrite(PGrnWALRecordBulkDelete *record)
+{
+	XLogBeginInsert();
+	XLogRegisterData((char *) record,
+					 offsetof(PGrnWALRecordBulkDelete, tableName));
+	XLogRegisterData((char *) &(record->tableNameSize), sizeof(uint32));
+	XLogRegisterData((char *) record->tableName, record->tableNameSize);
+	XLogRegisterData((char *) &(record->nKeys), sizeof(uint32));
+	XLogRegisterData((char *) record->keys, sizeof(uint64_t) * record->nKeys);
+	XLogInsert(PGRN_WAL_RESOURCE_MANAGER_ID,
+			   PGRN_WAL_RECORD_BULK_DELETE | XLR_SPECIAL_REL_UPDATE);
+}
+
+static inline void
+PGrnWALRecordBulkDeleteRead(PGrnWALRecordBulkDelete *record,
+							PGrnWALRecordRaw *raw)
+{
+	PGrnWALRecordRawReadData(
+		raw, record, offsetof(PGrnWALRecordBulkDelete, tableName));
+	PGrnWALRecordRawReadData(raw, &(record->tableNameSize), sizeof(uint32));
+	record->tableName = PGrnWALRecordRawRefer(raw, record->tableNameSize);
+	PGrnWALRecordRawReadData(raw, &(record->nKeys), sizeof(uint32));
+	record->keys = (const uint64_t *) PGrnWALRecordRawRefer(
+		raw, sizeof(uint64_t) * record->nKeys);
+	if (raw->size != 0)
+	{
+		ereport(ERROR,
+				errcode(ERRCODE_DATA_EXCEPTION),
+				errmsg("%s: "
+					   "[wal][record][read][bulk-delete] "
+					   "garbage at the end: %u",
+					   PGRN_TAG,
+					   raw->size));
+	}
+}
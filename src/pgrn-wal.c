@@ -2,8 +2,12 @@
 
 #include "pgrn-global.h"
 #include "pgrn-groonga.h"
+#include "pgrn-index-cache.h"
 #include "pgrn-index-status.h"
 #include "pgrn-pg.h"
+#ifdef PGRN_SUPPORT_WAL
+#	include "pgrn-wal-applier-statuses.h"
+#endif
 #include "pgrn-wal.h"
 #ifdef PGRN_SUPPORT_WAL_RESOURCE_MANAGER
 #	include "pgrn-wal-custom.h"
@@ -19,6 +23,9 @@ static bool PGrnWALEnabled = false;
 static size_t PGrnWALMaxSize = 0;
 static bool PGrnWALResourceManagerEnabled = false;
 static size_t PGrnWALMaxBulkInsertRecordSize = 16 * 1024 * 1024; /* 16MiB */
+static bool PGrnWALGroupCommitEnabled = false;
+static int PGrnWALAppliedPositionUpdateInterval = 100;
+static int PGrnWALMaxApplyDelay = -1;
 
 bool
 PGrnWALGetEnabled(void)
@@ -86,6 +93,48 @@ PGrnWALSetMaxBulkInsertRecordSize(size_t size)
 	PGrnWALMaxBulkInsertRecordSize = size;
 }
 
+bool
+PGrnWALGroupCommitGetEnabled(void)
+{
+	return PGrnWALGroupCommitEnabled;
+}
+
+void
+PGrnWALGroupCommitEnable(void)
+{
+	PGrnWALGroupCommitEnabled = true;
+}
+
+void
+PGrnWALGroupCommitDisable(void)
+{
+	PGrnWALGroupCommitEnabled = false;
+}
+
+int
+PGrnWALGetAppliedPositionUpdateInterval(void)
+{
+	return PGrnWALAppliedPositionUpdateInterval;
+}
+
+void
+PGrnWALSetAppliedPositionUpdateInterval(int interval)
+{
+	PGrnWALAppliedPositionUpdateInterval = interval;
+}
+
+int
+PGrnWALGetMaxApplyDelay(void)
+{
+	return PGrnWALMaxApplyDelay;
+}
+
+void
+PGrnWALSetMaxApplyDelay(int delay)
+{
+	PGrnWALMaxApplyDelay = delay;
+}
+
 static bool
 PGrnWALAnyEnabled(void)
 {
@@ -97,12 +146,18 @@ PGrnWALAnyEnabled(void)
 #	include <access/heapam.h>
 #	include <access/htup_details.h>
 #	include <miscadmin.h>
+#	include <pgstat.h>
 #	include <storage/bufmgr.h>
 #	include <storage/bufpage.h>
+#	include <storage/condition_variable.h>
 #	include <storage/lmgr.h>
 #	include <storage/lockdefs.h>
+#	include <storage/lwlock.h>
+#	include <storage/shmem.h>
+#	include <storage/spin.h>
 #	include <utils/acl.h>
 #	include <utils/builtins.h>
+#	include <utils/timestamp.h>
 
 #	include <msgpack.h>
 #endif
@@ -132,9 +187,40 @@ typedef enum
 	PGRN_WAL_ACTION_DELETE,
 	PGRN_WAL_ACTION_REMOVE_OBJECT,
 	PGRN_WAL_ACTION_REGISTER_PLUGIN,
+	PGRN_WAL_ACTION_BULK_DELETE,
 } PGrnWALAction;
 
-#	define PGRN_WAL_META_PAGE_SPECIAL_VERSION 1
+/*
+ * Records for per row operations (insert, delete and bulk delete)
+ * use the compact format. A compact record is an array instead of a
+ * map and refers objects without their names as much as possible:
+ *
+ *   [PGRN_WAL_ACTION_INSERT, table, column, value, column, value, ...]
+ *   [PGRN_WAL_ACTION_DELETE, table, key]
+ *   [PGRN_WAL_ACTION_BULK_DELETE, table, [ctid, delta, delta, ...]]
+ *
+ * table is nil for the sources table of the index. column is 0 for
+ * _key, N for the sources column of the N-th index attribute or a
+ * name string for others. A packed ctid key of the sources table is
+ * a positive integer instead of an 8 bytes binary. Ctids in bulk
+ * delete are sorted and delta encoded.
+ *
+ * The index definition is the dictionary for the compact
+ * references. We can't use a dictionary in WAL pages because we may
+ * start applying WAL from any record and old WAL pages may be
+ * overwritten. Old records that are maps are still applied.
+ *
+ * WAL format versions in the meta page:
+ *
+ *   1: All records are maps.
+ *   2: Per row operation records may be compact records.
+ *
+ * A writer updates the version of an existing meta page before it
+ * writes compact records. An applier refuses newer versions that it
+ * doesn't know instead of misreading them.
+ */
+
+#	define PGRN_WAL_META_PAGE_SPECIAL_VERSION 2
 
 typedef struct
 {
@@ -150,6 +236,72 @@ typedef struct
 	Buffer buffer;
 	Page page;
 } PGrnWALPageWriteData;
+
+/*
+ * Group commit: Concurrent writers for the same index don't write
+ * their WAL records to WAL pages by themselves. They modify Groonga
+ * and append their records to a shared queue while they have the WAL
+ * lock. So the order of queued records is the same as the order of
+ * Groonga modifications. After they release the WAL lock, one of them
+ * becomes the leader and writes all queued records with one generic
+ * xlog record. Others just wait for the leader.
+ *
+ * A queue is shared by indexes that have the same hash value. A
+ * writer writes its record by itself when the queue is used by
+ * another index or the queue is full. Anyone who writes WAL records
+ * by itself writes queued records for the index before its record.
+ */
+#	define PGRN_WAL_GROUP_COMMIT_N_QUEUES 4
+#	define PGRN_WAL_GROUP_COMMIT_QUEUE_SIZE BLCKSZ
+#	define PGRN_WAL_GROUP_COMMIT_TRANCHE_NAME "pgroonga_wal_group_commit"
+
+typedef struct PGrnWALGroupCommitQueue
+{
+	/* This protects all the following members. */
+	LWLock lock;
+	Oid databaseOID;
+	Oid indexOID;
+	/* Whether a leader is writing queued records or not. */
+	bool flushing;
+	/* The sequence number of the last queued record. */
+	uint64 nQueued;
+	/* The sequence number of the last written record. */
+	uint64 nWritten;
+	size_t size;
+	ConditionVariable conditionVariable;
+	char data[PGRN_WAL_GROUP_COMMIT_QUEUE_SIZE];
+} PGrnWALGroupCommitQueue;
+
+static PGrnWALGroupCommitQueue *PGrnWALGroupCommitQueues = NULL;
+/* Queued records are copied to this while they are written. */
+static char PGrnWALGroupCommitRecords[PGRN_WAL_GROUP_COMMIT_QUEUE_SIZE];
+
+/*
+ * Apply status: The LSN of the meta page when all WAL of an index
+ * are applied. All WAL writes including WAL writes replayed on
+ * standby update the LSN of the meta page. So we can detect that
+ * there are no WAL to be applied by comparing the LSN of the meta
+ * page with this without looking up the applied position in Groonga
+ * and reading WAL pages.
+ *
+ * A slot is shared by indexes that have the same hash value. A slot
+ * for another index is just overwritten.
+ */
+#	define PGRN_WAL_APPLY_STATUS_N_SLOTS 256
+
+typedef struct PGrnWALApplyStatus
+{
+	slock_t mutex;
+	Oid databaseOID;
+	Oid indexOID;
+	PGrnRelFileNumber indexFileNumber;
+	XLogRecPtr appliedLSN;
+	/* When we confirmed that all WAL are applied. */
+	TimestampTz appliedTime;
+} PGrnWALApplyStatus;
+
+static PGrnWALApplyStatus *PGrnWALApplyStatuses = NULL;
+static pgrn_wal_applier_statuses *PGrnWALApplierStatuses = NULL;
 #endif
 
 struct PGrnWALData_
@@ -157,6 +309,14 @@ struct PGrnWALData_
 	Relation index;
 	grn_obj *table;
 	bool bulkInserting;
+#ifdef PGRN_SUPPORT_WAL_RESOURCE_MANAGER
+	/* This refers buffers->walRecord or bulkInsertRecord. */
+	grn_obj *record;
+	/* Bulk insert may be mixed with other WAL records. For example, a
+	 * buffered insert for an index and an insert for another index in
+	 * the same statement. So bulk insert uses its own buffer. */
+	grn_obj bulkInsertRecord;
+#endif
 #ifdef PGRN_SUPPORT_WAL
 	GenericXLogState *state;
 	unsigned int nUsedPages;
@@ -174,6 +334,13 @@ struct PGrnWALData_
 	size_t nBuffers;
 	Buffer buffers[MAX_GENERIC_XLOG_PAGES];
 	msgpack_packer packer;
+	/* Records are serialized into groupCommitRecord instead of WAL
+	 * pages on group commit. */
+	bool groupCommitting;
+	grn_obj groupCommitRecord;
+	/* Whether the current insert record is for the sources table of
+	 * the index. Compact references are used for it. */
+	bool insertingSources;
 #endif
 };
 
@@ -213,6 +380,78 @@ msgpack_pack_grn_obj(msgpack_packer *packer, grn_obj *object)
 		msgpack_pack_nil(packer);
 	}
 }
+
+static bool
+PGrnWALIsSourcesTable(Relation index, grn_obj *table)
+{
+	char name[GRN_TABLE_MAX_KEY_SIZE];
+	int nameSize;
+	char sourcesName[GRN_TABLE_MAX_KEY_SIZE];
+	int sourcesNameSize;
+
+	if (!table)
+		return true;
+
+	nameSize = grn_obj_name(ctx, table, name, GRN_TABLE_MAX_KEY_SIZE);
+	sourcesNameSize = snprintf(sourcesName,
+							   sizeof(sourcesName),
+							   PGrnSourcesTableNameFormat,
+							   PGRN_RELATION_GET_LOCATOR_NUMBER(index));
+	return nameSize == sourcesNameSize &&
+		   memcmp(name, sourcesName, nameSize) == 0;
+}
+
+/* Returns 0 when the column isn't a column for an index attribute. */
+static uint32_t
+PGrnWALGetSourcesColumnReference(Relation index,
+								 const char *name,
+								 size_t nameSize)
+{
+	TupleDesc desc = RelationGetDescr(index);
+	int i;
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		Form_pg_attribute attribute = TupleDescAttr(desc, i);
+		char columnName[GRN_TABLE_MAX_KEY_SIZE];
+		size_t columnNameSize;
+
+		columnNameSize =
+			PGrnColumnNameEncode(NameStr(attribute->attname), columnName);
+		if (columnNameSize == nameSize &&
+			memcmp(columnName, name, nameSize) == 0)
+			return i + 1;
+	}
+	return 0;
+}
+
+static void
+msgpack_pack_table(msgpack_packer *packer, Relation index, grn_obj *table)
+{
+	if (PGrnWALIsSourcesTable(index, table))
+		msgpack_pack_nil(packer);
+	else
+		msgpack_pack_grn_obj(packer, table);
+}
+
+static void
+msgpack_pack_key(msgpack_packer *packer,
+				 bool isSourcesKey,
+				 const char *key,
+				 size_t keySize)
+{
+	if (isSourcesKey && keySize == sizeof(uint64_t))
+	{
+		uint64_t packedCtid;
+		memcpy(&packedCtid, key, sizeof(uint64_t));
+		msgpack_pack_uint64(packer, packedCtid);
+	}
+	else
+	{
+		msgpack_pack_bin(packer, keySize);
+		msgpack_pack_bin_body(packer, key, keySize);
+	}
+}
 #endif
 
 #define PGRN_WAL_META_PAGE_BLOCK_NUMBER 0
@@ -236,6 +475,123 @@ PGrnWALReadLockedBuffer(Relation index,
 	return buffer;
 }
 
+static XLogRecPtr
+PGrnWALGetMetaLSN(Relation index)
+{
+	Buffer buffer;
+	XLogRecPtr lsn;
+
+	buffer = PGrnWALReadLockedBuffer(
+		index, PGRN_WAL_META_PAGE_BLOCK_NUMBER, BUFFER_LOCK_SHARE);
+	lsn = PageGetLSN(BufferGetPage(buffer));
+	UnlockReleaseBuffer(buffer);
+
+	return lsn;
+}
+
+static PGrnWALApplyStatus *
+PGrnWALApplyStatusGet(Relation index)
+{
+	uint32 hash = MyDatabaseId + RelationGetRelid(index);
+	if (!PGrnWALApplyStatuses)
+		return NULL;
+	/* Pages of an index that isn't WAL-logged don't have LSN. */
+	if (!RelationNeedsWAL(index))
+		return NULL;
+	return &(PGrnWALApplyStatuses[hash % PGRN_WAL_APPLY_STATUS_N_SLOTS]);
+}
+
+static void
+PGrnWALApplyStatusSetApplied(Relation index, XLogRecPtr lsn)
+{
+	PGrnWALApplyStatus *status = PGrnWALApplyStatusGet(index);
+	TimestampTz now;
+
+	if (!status)
+		return;
+
+	now = GetCurrentTimestamp();
+	SpinLockAcquire(&(status->mutex));
+	status->databaseOID = MyDatabaseId;
+	status->indexOID = RelationGetRelid(index);
+	status->indexFileNumber = PGRN_RELATION_GET_LOCATOR_NUMBER(index);
+	status->appliedLSN = lsn;
+	status->appliedTime = now;
+	SpinLockRelease(&(status->mutex));
+}
+
+static void
+PGrnWALApplyStatusReset(Relation index)
+{
+	PGrnWALApplyStatus *status = PGrnWALApplyStatusGet(index);
+
+	if (!status)
+		return;
+
+	SpinLockAcquire(&(status->mutex));
+	if (status->databaseOID == MyDatabaseId &&
+		status->indexOID == RelationGetRelid(index))
+	{
+		status->appliedLSN = InvalidXLogRecPtr;
+		status->appliedTime = 0;
+	}
+	SpinLockRelease(&(status->mutex));
+}
+
+/*
+ * Returns whether all WAL of the index are applied. false doesn't
+ * mean that there are WAL to be applied. It just means that we don't
+ * know.
+ *
+ * If appliedTime isn't NULL, it's set to the last time when we
+ * confirmed that all WAL are applied.
+ */
+static bool
+PGrnWALApplyStatusIsApplied(Relation index, TimestampTz *appliedTime)
+{
+	PGrnWALApplyStatus *status = PGrnWALApplyStatusGet(index);
+	XLogRecPtr appliedLSN = InvalidXLogRecPtr;
+	bool applied;
+
+	if (appliedTime)
+		*appliedTime = 0;
+
+	if (!status)
+		return false;
+
+	SpinLockAcquire(&(status->mutex));
+	if (status->databaseOID == MyDatabaseId &&
+		status->indexOID == RelationGetRelid(index) &&
+		status->indexFileNumber == PGRN_RELATION_GET_LOCATOR_NUMBER(index))
+	{
+		appliedLSN = status->appliedLSN;
+		if (appliedTime)
+			*appliedTime = status->appliedTime;
+	}
+	SpinLockRelease(&(status->mutex));
+
+	/* The meta page exists when we have the applied LSN. */
+	if (XLogRecPtrIsInvalid(appliedLSN))
+		return false;
+
+	applied = (PGrnWALGetMetaLSN(index) == appliedLSN);
+	if (applied)
+	{
+		TimestampTz now = GetCurrentTimestamp();
+		SpinLockAcquire(&(status->mutex));
+		/* The slot may be used by another index while we read the
+		 * meta page. */
+		if (status->databaseOID == MyDatabaseId &&
+			status->indexOID == RelationGetRelid(index) &&
+			status->indexFileNumber ==
+				PGRN_RELATION_GET_LOCATOR_NUMBER(index) &&
+			status->appliedLSN == appliedLSN)
+			status->appliedTime = now;
+		SpinLockRelease(&(status->mutex));
+	}
+	return applied;
+}
+
 static char *
 PGrnWALPageGetData(Page page)
 {
@@ -317,6 +673,10 @@ PGrnWALDataInitMeta(PGrnWALData *data)
 			GenericXLogRegisterBuffer(data->state, data->meta.buffer, 0);
 		data->meta.pageSpecial =
 			(PGrnWALMetaPageSpecial *) PageGetSpecialPointer(data->meta.page);
+		if (data->meta.pageSpecial->version <
+			PGRN_WAL_META_PAGE_SPECIAL_VERSION)
+			data->meta.pageSpecial->version =
+				PGRN_WAL_META_PAGE_SPECIAL_VERSION;
 	}
 }
 
@@ -344,6 +704,8 @@ PGrnWALDataFinish(PGrnWALData *data)
 	}
 	GenericXLogFinish(data->state);
 	PGrnIndexStatusSetWALAppliedPosition(data->index, block, offset);
+	PGrnWALApplyStatusSetApplied(
+		data->index, PageGetLSN(BufferGetPage(data->meta.buffer)));
 }
 
 static void
@@ -514,13 +876,288 @@ PGrnWALUnlock(Relation index)
 {
 	UnlockPage(index, PGrnWALLockBlockNumber(), PGrnWALLockMode());
 }
+
+static int
+PGrnWALGroupCommitRecordWriter(void *userData,
+							   const char *buffer,
+							   size_t length)
+{
+	PGrnWALData *data = userData;
+
+	GRN_TEXT_PUT(ctx, &(data->groupCommitRecord), buffer, length);
+	return length;
+}
+
+static bool
+PGrnWALGroupCommitIsUsable(void)
+{
+	if (!PGrnWALGroupCommitEnabled)
+		return false;
+	if (!PGrnWALGroupCommitQueues)
+		return false;
+	if (RecoveryInProgress())
+		return false;
+	return true;
+}
+
+static PGrnWALGroupCommitQueue *
+PGrnWALGroupCommitGetQueue(Relation index)
+{
+	uint32 hash = MyDatabaseId + RelationGetRelid(index);
+	return &(PGrnWALGroupCommitQueues[hash % PGRN_WAL_GROUP_COMMIT_N_QUEUES]);
+}
+
+/* The caller must have the WAL lock. */
+static void
+PGrnWALWriteRecords(Relation index, const char *records, size_t size)
+{
+	PGrnWALData data;
+
+	data.index = index;
+	data.state = GenericXLogStart(index);
+	PGrnWALDataInitBuffers(&data);
+	PGrnWALDataInitNUsedPages(&data);
+	PGrnWALDataInitMeta(&data);
+	PGrnWALDataInitCurrent(&data);
+	PGrnWALPageWriter(&data, records, size);
+	PGrnWALDataFinish(&data);
+	PGrnWALDataReleaseBuffers(&data);
+}
+
+/* The caller must have the WAL lock. */
+static bool
+PGrnWALGroupCommitEnqueue(PGrnWALGroupCommitQueue *queue,
+						  Relation index,
+						  grn_obj *record,
+						  uint64 *sequence)
+{
+	bool enqueued = false;
+
+	LWLockAcquire(&(queue->lock), LW_EXCLUSIVE);
+	if (queue->size == 0)
+	{
+		queue->databaseOID = MyDatabaseId;
+		queue->indexOID = RelationGetRelid(index);
+	}
+	if (queue->databaseOID == MyDatabaseId &&
+		queue->indexOID == RelationGetRelid(index) &&
+		queue->size + GRN_TEXT_LEN(record) <= PGRN_WAL_GROUP_COMMIT_QUEUE_SIZE)
+	{
+		memcpy(queue->data + queue->size,
+			   GRN_TEXT_VALUE(record),
+			   GRN_TEXT_LEN(record));
+		queue->size += GRN_TEXT_LEN(record);
+		queue->nQueued++;
+		*sequence = queue->nQueued;
+		enqueued = true;
+	}
+	LWLockRelease(&(queue->lock));
+
+	return enqueued;
+}
+
+/*
+ * Writes all queued records for the index. The caller must have the
+ * WAL lock. So nobody can queue a new record for the index while
+ * this writes queued records.
+ *
+ * Queued records are removed from the queue only when they are
+ * written. So another writer can retry them when this fails.
+ */
+static void
+PGrnWALGroupCommitDrain(Relation index)
+{
+	PGrnWALGroupCommitQueue *queue;
+	size_t size;
+	uint64 sequence;
+
+	if (!PGrnWALGroupCommitQueues)
+		return;
+
+	queue = PGrnWALGroupCommitGetQueue(index);
+	LWLockAcquire(&(queue->lock), LW_EXCLUSIVE);
+	if (queue->size == 0 || queue->databaseOID != MyDatabaseId ||
+		queue->indexOID != RelationGetRelid(index))
+	{
+		LWLockRelease(&(queue->lock));
+		return;
+	}
+	size = queue->size;
+	sequence = queue->nQueued;
+	memcpy(PGrnWALGroupCommitRecords, queue->data, size);
+	LWLockRelease(&(queue->lock));
+
+	PGrnWALWriteRecords(index, PGrnWALGroupCommitRecords, size);
+
+	LWLockAcquire(&(queue->lock), LW_EXCLUSIVE);
+	queue->size -= size;
+	memmove(queue->data, queue->data + size, queue->size);
+	queue->nWritten = sequence;
+	LWLockRelease(&(queue->lock));
+	ConditionVariableBroadcast(&(queue->conditionVariable));
+}
+
+static void
+PGrnWALGroupCommitFlush(PGrnWALGroupCommitQueue *queue, Relation index)
+{
+	PG_TRY();
+	{
+		PGrnWALLock(index);
+		/* Records queued while we wait for the lock are also written. */
+		PGrnWALGroupCommitDrain(index);
+		PGrnWALUnlock(index);
+	}
+	PG_CATCH();
+	{
+		LWLockAcquire(&(queue->lock), LW_EXCLUSIVE);
+		queue->flushing = false;
+		LWLockRelease(&(queue->lock));
+		ConditionVariableBroadcast(&(queue->conditionVariable));
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	LWLockAcquire(&(queue->lock), LW_EXCLUSIVE);
+	queue->flushing = false;
+	LWLockRelease(&(queue->lock));
+	ConditionVariableBroadcast(&(queue->conditionVariable));
+}
+
+/*
+ * The caller must have the WAL lock. This releases the WAL lock
+ * before this waits for the leader.
+ */
+static void
+PGrnWALGroupCommit(PGrnWALData *data)
+{
+	Relation index = data->index;
+	grn_obj *record = &(data->groupCommitRecord);
+	PGrnWALGroupCommitQueue *queue;
+	uint64 sequence;
+
+	if (GRN_TEXT_LEN(record) == 0)
+	{
+		PGrnWALUnlock(index);
+		return;
+	}
+
+	queue = PGrnWALGroupCommitGetQueue(index);
+	if (!PGrnWALGroupCommitEnqueue(queue, index, record, &sequence))
+	{
+		/* Records queued before our record must be written before our
+		 * record. */
+		PGrnWALGroupCommitDrain(index);
+		PGrnWALWriteRecords(
+			index, GRN_TEXT_VALUE(record), GRN_TEXT_LEN(record));
+		PGrnWALUnlock(index);
+		return;
+	}
+	PGrnWALUnlock(index);
+
+	ConditionVariablePrepareToSleep(&(queue->conditionVariable));
+	while (true)
+	{
+		bool written;
+		bool leader = false;
+
+		LWLockAcquire(&(queue->lock), LW_EXCLUSIVE);
+		written = (queue->nWritten >= sequence);
+		if (!written && !queue->flushing)
+		{
+			queue->flushing = true;
+			leader = true;
+		}
+		LWLockRelease(&(queue->lock));
+		if (written)
+			break;
+
+		if (leader)
+			PGrnWALGroupCommitFlush(queue, index);
+		else
+			ConditionVariableSleep(&(queue->conditionVariable),
+								   PG_WAIT_EXTENSION);
+	}
+	ConditionVariableCancelSleep();
+}
+#endif
+
+Size
+PGrnWALSharedMemorySize(void)
+{
+	Size size = 0;
+#ifdef PGRN_SUPPORT_WAL
+	size = add_size(size,
+					mul_size(sizeof(PGrnWALGroupCommitQueue),
+							 PGRN_WAL_GROUP_COMMIT_N_QUEUES));
+	size = add_size(size,
+					mul_size(sizeof(PGrnWALApplyStatus),
+							 PGRN_WAL_APPLY_STATUS_N_SLOTS));
+	size = add_size(size, sizeof(pgrn_wal_applier_statuses));
+#endif
+	return size;
+}
+
+void
+PGrnInitializeWAL(void)
+{
+#ifdef PGRN_SUPPORT_WAL
+	bool found;
+	size_t i;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	PGrnWALGroupCommitQueues = (PGrnWALGroupCommitQueue *) ShmemInitStruct(
+		"PGrnWALGroupCommitQueues",
+		sizeof(PGrnWALGroupCommitQueue) * PGRN_WAL_GROUP_COMMIT_N_QUEUES,
+		&found);
+	if (!found)
+	{
+		int trancheID = LWLockNewTrancheId();
+		for (i = 0; i < PGRN_WAL_GROUP_COMMIT_N_QUEUES; i++)
+		{
+			PGrnWALGroupCommitQueue *queue = &(PGrnWALGroupCommitQueues[i]);
+			LWLockInitialize(&(queue->lock), trancheID);
+			queue->databaseOID = InvalidOid;
+			queue->indexOID = InvalidOid;
+			queue->flushing = false;
+			queue->nQueued = 0;
+			queue->nWritten = 0;
+			queue->size = 0;
+			ConditionVariableInit(&(queue->conditionVariable));
+		}
+	}
+	PGrnWALApplyStatuses = (PGrnWALApplyStatus *) ShmemInitStruct(
+		"PGrnWALApplyStatuses",
+		sizeof(PGrnWALApplyStatus) * PGRN_WAL_APPLY_STATUS_N_SLOTS,
+		&found);
+	if (!found)
+	{
+		for (i = 0; i < PGRN_WAL_APPLY_STATUS_N_SLOTS; i++)
+		{
+			PGrnWALApplyStatus *status = &(PGrnWALApplyStatuses[i]);
+			SpinLockInit(&(status->mutex));
+			status->databaseOID = InvalidOid;
+			status->indexOID = InvalidOid;
+			status->indexFileNumber = InvalidOid;
+			status->appliedLSN = InvalidXLogRecPtr;
+			status->appliedTime = 0;
+		}
+	}
+	LWLockRelease(AddinShmemInitLock);
+	LWLockRegisterTranche(PGrnWALGroupCommitQueues[0].lock.tranche,
+						  PGRN_WAL_GROUP_COMMIT_TRANCHE_NAME);
+
+	PGrnWALApplierStatuses = pgrn_wal_applier_statuses_get();
 #endif
+}
 
 PGrnWALData *
 PGrnWALStart(Relation index)
 {
 #if defined(PGRN_SUPPORT_WAL) || defined(PGRN_SUPPORT_WAL_RESOURCE_MANAGER)
 	PGrnWALData *data;
+#	ifdef PGRN_SUPPORT_WAL
+	bool groupCommitting;
+#	endif
 
 	if (!PGrnWALAnyEnabled())
 		return NULL;
@@ -528,6 +1165,7 @@ PGrnWALStart(Relation index)
 		return NULL;
 
 #	ifdef PGRN_SUPPORT_WAL
+	groupCommitting = PGrnWALEnabled && PGrnWALGroupCommitIsUsable();
 	if (PGrnWALEnabled)
 		PGrnWALLock(index);
 #	endif
@@ -535,18 +1173,36 @@ PGrnWALStart(Relation index)
 	data = palloc(sizeof(PGrnWALData));
 	data->table = NULL;
 	data->bulkInserting = false;
+#	ifdef PGRN_SUPPORT_WAL_RESOURCE_MANAGER
+	data->record = &(buffers->walRecord);
+#	endif
 
 #	ifdef PGRN_SUPPORT_WAL
 	if (PGrnWALEnabled)
 	{
 		data->index = index;
-		data->state = GenericXLogStart(data->index);
+		data->groupCommitting = groupCommitting;
+		data->insertingSources = false;
+		if (data->groupCommitting)
+		{
+			GRN_TEXT_INIT(&(data->groupCommitRecord), 0);
+			msgpack_packer_init(&(data->packer),
+								data,
+								PGrnWALGroupCommitRecordWriter);
+		}
+		else
+		{
+			/* Queued records must be written before our records. */
+			PGrnWALGroupCommitDrain(data->index);
 
-		PGrnWALDataInitBuffers(data);
-		PGrnWALDataInitNUsedPages(data);
-		PGrnWALDataInitMeta(data);
-		PGrnWALDataInitCurrent(data);
-		PGrnWALDataInitMessagePack(data);
+			data->state = GenericXLogStart(data->index);
+
+			PGrnWALDataInitBuffers(data);
+			PGrnWALDataInitNUsedPages(data);
+			PGrnWALDataInitMeta(data);
+			PGrnWALDataInitCurrent(data);
+			PGrnWALDataInitMessagePack(data);
+		}
 	}
 #	endif
 
@@ -566,11 +1222,19 @@ PGrnWALFinish(PGrnWALData *data)
 #	ifdef PGRN_SUPPORT_WAL
 	if (PGrnWALEnabled)
 	{
-		PGrnWALDataFinish(data);
+		if (data->groupCommitting)
+		{
+			PGrnWALGroupCommit(data);
+			GRN_OBJ_FIN(ctx, &(data->groupCommitRecord));
+		}
+		else
+		{
+			PGrnWALDataFinish(data);
 
-		PGrnWALDataReleaseBuffers(data);
+			PGrnWALDataReleaseBuffers(data);
 
-		PGrnWALUnlock(data->index);
+			PGrnWALUnlock(data->index);
+		}
 	}
 #	endif
 
@@ -588,7 +1252,10 @@ PGrnWALAbort(PGrnWALData *data)
 #	ifdef PGRN_SUPPORT_WAL
 	if (PGrnWALEnabled)
 	{
-		GenericXLogAbort(data->state);
+		if (data->groupCommitting)
+			GRN_OBJ_FIN(ctx, &(data->groupCommitRecord));
+		else
+			GenericXLogAbort(data->state);
 
 /* For PostgreSQL on Amazon Linux 2. PostgreSQL 12.8 or later provides this. */
 #		ifndef INTERRUPTS_CAN_BE_PROCESSED
@@ -597,13 +1264,19 @@ PGrnWALAbort(PGrnWALData *data)
 
 		if (!INTERRUPTS_CAN_BE_PROCESSED())
 		{
-			PGrnWALDataReleaseBuffers(data);
+			if (!data->groupCommitting)
+				PGrnWALDataReleaseBuffers(data);
 
 			PGrnWALUnlock(data->index);
 		}
 	}
 #	endif
 
+#	ifdef PGRN_SUPPORT_WAL_RESOURCE_MANAGER
+	if (data->record == &(data->bulkInsertRecord))
+		GRN_OBJ_FIN(ctx, data->record);
+#	endif
+
 	pfree(data);
 #endif
 }
@@ -616,14 +1289,15 @@ PGrnWALBulkInsertStartCustom(PGrnWALData *data, grn_obj *table)
 		return;
 
 	{
-		grn_obj *buffer = &(buffers->walRecord);
+		grn_obj *buffer = &(data->bulkInsertRecord);
 		PGrnWALRecordCommon record = {
 			.dbID = MyDatabaseId,
 			.dbEncoding = GetDatabaseEncoding(),
 			.dbTableSpaceID = MyDatabaseTableSpace,
 		};
 
-		GRN_BULK_REWIND(buffer);
+		GRN_TEXT_INIT(buffer, 0);
+		data->record = buffer;
 		PGrnWALRecordBulkInsertWriteStart(buffer, &record, table);
 	}
 }
@@ -652,8 +1326,10 @@ PGrnWALBulkInsertFinishCustom(PGrnWALData *data)
 		return;
 
 	{
-		grn_obj *buffer = &(buffers->walRecord);
+		grn_obj *buffer = data->record;
 		PGrnWALRecordBulkInsertWriteFinish(buffer);
+		GRN_OBJ_FIN(ctx, buffer);
+		data->record = &(buffers->walRecord);
 	}
 }
 #endif
@@ -675,28 +1351,15 @@ static void
 PGrnWALInsertStartGeneric(PGrnWALData *data, grn_obj *table, size_t nColumns)
 {
 	msgpack_packer *packer;
-	size_t nElements = nColumns;
 
 	if (!PGrnWALEnabled)
 		return;
 
-	if (table)
-		nElements++;
-
 	packer = &(data->packer);
-	msgpack_pack_map(packer, nElements);
-
-	if (table)
-	{
-		char tableName[GRN_TABLE_MAX_KEY_SIZE];
-		int tableNameSize;
-
-		tableNameSize =
-			grn_obj_name(ctx, table, tableName, GRN_TABLE_MAX_KEY_SIZE);
-		msgpack_pack_cstr(packer, "_table");
-		msgpack_pack_str(packer, tableNameSize);
-		msgpack_pack_str_body(packer, tableName, tableNameSize);
-	}
+	msgpack_pack_array(packer, 2 + (nColumns * 2));
+	msgpack_pack_uint32(packer, PGRN_WAL_ACTION_INSERT);
+	data->insertingSources = PGrnWALIsSourcesTable(data->index, table);
+	msgpack_pack_table(packer, data->index, table);
 }
 #endif
 
@@ -708,7 +1371,7 @@ PGrnWALInsertStartCustom(PGrnWALData *data, grn_obj *table, size_t nColumns)
 		return;
 
 	{
-		grn_obj *buffer = &(buffers->walRecord);
+		grn_obj *buffer = data->record;
 		PGrnWALRecordCommon record = {
 			.dbID = MyDatabaseId,
 			.dbEncoding = GetDatabaseEncoding(),
@@ -767,7 +1430,7 @@ PGrnWALInsertFinishCustom(PGrnWALData *data)
 		return;
 
 	{
-		grn_obj *buffer = &(buffers->walRecord);
+		grn_obj *buffer = data->record;
 		if (data->bulkInserting)
 			PGrnWALRecordBulkInsertWriteRecordFinish(buffer);
 		else
@@ -798,17 +1461,36 @@ PGrnWALInsertColumnStartGeneric(PGrnWALData *data,
 {
 	msgpack_packer *packer;
 
+	uint32_t reference = 0;
+
 	if (!PGrnWALEnabled)
 		return;
 
 	packer = &(data->packer);
 
-	msgpack_pack_str(packer, nameSize);
-	msgpack_pack_str_body(packer, name, nameSize);
-}
-#endif
+	if (nameSize == GRN_COLUMN_NAME_KEY_LEN &&
+		memcmp(name, GRN_COLUMN_NAME_KEY, GRN_COLUMN_NAME_KEY_LEN) == 0)
+	{
+		msgpack_pack_uint32(packer, 0);
+		return;
+	}
 
-#ifdef PGRN_SUPPORT_WAL_RESOURCE_MANAGER
+	if (data->insertingSources)
+		reference =
+			PGrnWALGetSourcesColumnReference(data->index, name, nameSize);
+	if (reference > 0)
+	{
+		msgpack_pack_uint32(packer, reference);
+	}
+	else
+	{
+		msgpack_pack_str(packer, nameSize);
+		msgpack_pack_str_body(packer, name, nameSize);
+	}
+}
+#endif
+
+#ifdef PGRN_SUPPORT_WAL_RESOURCE_MANAGER
 static void
 PGrnWALInsertColumnStartCustom(PGrnWALData *data,
 							   const char *name,
@@ -818,7 +1500,7 @@ PGrnWALInsertColumnStartCustom(PGrnWALData *data,
 		return;
 
 	{
-		grn_obj *buffer = &(buffers->walRecord);
+		grn_obj *buffer = data->record;
 		if (data->bulkInserting)
 			PGrnWALRecordBulkInsertWriteColumnStart(buffer, name, nameSize);
 		else
@@ -860,8 +1542,7 @@ PGrnWALInsertColumnValueKeyGeneric(PGrnWALData *data,
 		return;
 
 	packer = &(data->packer);
-	msgpack_pack_bin(packer, keySize);
-	msgpack_pack_bin_body(packer, key, keySize);
+	msgpack_pack_key(packer, data->insertingSources, key, keySize);
 }
 #endif
 
@@ -875,7 +1556,7 @@ PGrnWALInsertColumnValueKeyCustom(PGrnWALData *data,
 		return;
 
 	{
-		grn_obj *buffer = &(buffers->walRecord);
+		grn_obj *buffer = data->record;
 		if (data->bulkInserting)
 			PGrnWALRecordBulkInsertWriteColumnValueKey(buffer, key, keySize);
 		else
@@ -1015,7 +1696,7 @@ PGrnWALInsertColumnValueBulkCustom(PGrnWALData *data,
 		return;
 
 	{
-		grn_obj *buffer = &(buffers->walRecord);
+		grn_obj *buffer = data->record;
 		if (data->bulkInserting)
 		{
 			PGrnWALRecordBulkInsertWriteColumnValueBulk(
@@ -1086,7 +1767,7 @@ PGrnWALInsertColumnValueVectorCustom(PGrnWALData *data,
 		return;
 
 	{
-		grn_obj *buffer = &(buffers->walRecord);
+		grn_obj *buffer = data->record;
 		if (data->bulkInserting)
 		{
 			PGrnWALRecordBulkInsertWriteColumnValueVector(
@@ -1158,7 +1839,7 @@ PGrnWALInsertColumnUValueVectorCustom(PGrnWALData *data,
 		return;
 
 	{
-		grn_obj *buffer = &(buffers->walRecord);
+		grn_obj *buffer = data->record;
 		if (data->bulkInserting)
 		{
 			PGrnWALRecordBulkInsertWriteColumnValueUVector(
@@ -1640,17 +2321,11 @@ PGrnWALDeleteGeneric(Relation index,
 		return;
 
 	packer = &(data->packer);
-	msgpack_pack_map(packer, nElements);
-
-	msgpack_pack_cstr(packer, "_action");
+	msgpack_pack_array(packer, nElements);
 	msgpack_pack_uint32(packer, PGRN_WAL_ACTION_DELETE);
-
-	msgpack_pack_cstr(packer, "table");
-	msgpack_pack_grn_obj(packer, table);
-
-	msgpack_pack_cstr(packer, "key");
-	msgpack_pack_bin(packer, keySize);
-	msgpack_pack_bin_body(packer, key, keySize);
+	msgpack_pack_table(packer, index, table);
+	msgpack_pack_key(
+		packer, PGrnWALIsSourcesTable(index, table), key, keySize);
 
 	PGrnWALFinish(data);
 }
@@ -1697,6 +2372,113 @@ PGrnWALDelete(Relation index, grn_obj *table, const char *key, size_t keySize)
 #endif
 }
 
+#ifdef PGRN_SUPPORT_WAL
+static int
+PGrnWALPackedCtidCompare(const void *a, const void *b)
+{
+	uint64_t packedCtidA = *((const uint64_t *) a);
+	uint64_t packedCtidB = *((const uint64_t *) b);
+
+	if (packedCtidA < packedCtidB)
+		return -1;
+	else if (packedCtidA > packedCtidB)
+		return 1;
+	else
+		return 0;
+}
+
+static void
+PGrnWALBulkDeleteGeneric(Relation index, grn_obj *table, grn_obj *packedCtids)
+{
+	PGrnWALData *data;
+	msgpack_packer *packer;
+	size_t nElements = 3;
+	size_t nKeys = GRN_BULK_VSIZE(packedCtids) / sizeof(uint64_t);
+	uint64_t *sortedPackedCtids;
+	size_t i;
+
+	if (!PGrnWALEnabled)
+		return;
+
+	data = PGrnWALStart(index);
+	if (!data)
+		return;
+
+	sortedPackedCtids = palloc(sizeof(uint64_t) * Max(nKeys, 1));
+	memcpy(sortedPackedCtids,
+		   GRN_BULK_HEAD(packedCtids),
+		   sizeof(uint64_t) * nKeys);
+	qsort(sortedPackedCtids,
+		  nKeys,
+		  sizeof(uint64_t),
+		  PGrnWALPackedCtidCompare);
+
+	packer = &(data->packer);
+	msgpack_pack_array(packer, nElements);
+	msgpack_pack_uint32(packer, PGRN_WAL_ACTION_BULK_DELETE);
+	msgpack_pack_table(packer, index, table);
+	msgpack_pack_array(packer, nKeys);
+	for (i = 0; i < nKeys; i++)
+	{
+		if (i == 0)
+			msgpack_pack_uint64(packer, sortedPackedCtids[i]);
+		else
+			msgpack_pack_uint64(packer,
+								sortedPackedCtids[i] -
+									sortedPackedCtids[i - 1]);
+	}
+	pfree(sortedPackedCtids);
+
+	PGrnWALFinish(data);
+}
+#endif
+
+#ifdef PGRN_SUPPORT_WAL_RESOURCE_MANAGER
+static void
+PGrnWALBulkDeleteCustom(Relation index, grn_obj *table, grn_obj *packedCtids)
+{
+	PGrnWALRecordBulkDelete record;
+	char tableName[GRN_TABLE_MAX_KEY_SIZE];
+	int tableNameSize;
+
+	if (!PGrnWALResourceManagerEnabled)
+		return;
+
+	tableNameSize = grn_obj_name(ctx, table, tableName, GRN_TABLE_MAX_KEY_SIZE);
+	PGrnWALRecordBulkDeleteFill(&record,
+								MyDatabaseId,
+								GetDatabaseEncoding(),
+								MyDatabaseTableSpace,
+								tableName,
+								tableNameSize,
+								GRN_BULK_VSIZE(packedCtids) / sizeof(uint64_t),
+								(const uint64_t *) GRN_BULK_HEAD(packedCtids));
+	PGrnWALRecordBulkDeleteWrite(&record);
+}
+#endif
+
+/*
+ * Writes one WAL record for all packed ctids (GRN_UINT64 vector) deleted
+ * from the sources table. This is used by bulk delete instead of
+ * PGrnWALDelete() for each record to reduce the number of WAL records.
+ */
+void
+PGrnWALBulkDelete(Relation index, grn_obj *table, grn_obj *packedCtids)
+{
+	if (!RelationIsValid(index))
+		return;
+
+	if (GRN_BULK_VSIZE(packedCtids) == 0)
+		return;
+
+#ifdef PGRN_SUPPORT_WAL
+	PGrnWALBulkDeleteGeneric(index, table, packedCtids);
+#endif
+#ifdef PGRN_SUPPORT_WAL_RESOURCE_MANAGER
+	PGrnWALBulkDeleteCustom(index, table, packedCtids);
+#endif
+}
+
 #ifdef PGRN_SUPPORT_WAL
 static void
 PGrnWALRemoveObjectGeneric(Relation index, const char *name, size_t nameSize)
@@ -1849,6 +2631,14 @@ typedef struct
 		LocationIndex offset;
 	} current;
 	grn_obj *sources;
+	/* The LSN of the meta page when we started applying. */
+	XLogRecPtr lsn;
+	/*
+	 * Whether the last applied record can be applied again without
+	 * changing the result. If it's true, we can defer updating the
+	 * applied position.
+	 */
+	bool replayable;
 } PGrnWALApplyData;
 
 static bool
@@ -1857,15 +2647,26 @@ PGrnWALApplyNeeded(PGrnWALApplyData *data)
 	BlockNumber currentBlock;
 	LocationIndex currentOffset;
 	BlockNumber nBlocks;
+	XLogRecPtr lsn;
+
+	if (PGrnWALApplyStatusIsApplied(data->index, NULL))
+		return false;
+
+	nBlocks = RelationGetNumberOfBlocks(data->index);
+	if (nBlocks == 0)
+		return false;
+	/* We must read this before we read WAL. WAL written after this
+	 * changes the LSN. */
+	lsn = PGrnWALGetMetaLSN(data->index);
 
 	PGrnIndexStatusGetWALAppliedPosition(
 		data->index, &currentBlock, &currentOffset);
 	if (currentBlock == PGRN_WAL_META_PAGE_BLOCK_NUMBER)
 		currentBlock++;
 
-	nBlocks = RelationGetNumberOfBlocks(data->index);
 	if (currentBlock >= nBlocks)
 	{
+		PGrnWALApplyStatusSetApplied(data->index, lsn);
 		return false;
 	}
 	else
@@ -1905,7 +2706,10 @@ PGrnWALApplyNeeded(PGrnWALApplyData *data)
 			UnlockReleaseBuffer(nextBuffer);
 		}
 		if (!needToApply)
+		{
+			PGrnWALApplyStatusSetApplied(data->index, lsn);
 			return false;
+		}
 	}
 
 	return PGrnIsWritable();
@@ -2320,6 +3124,69 @@ PGrnWALApplyInsertArray(PGrnWALApplyData *data,
 	}
 }
 
+static void
+PGrnWALApplyInsertValue(PGrnWALApplyData *data,
+						const char *context,
+						grn_obj *column,
+						grn_id id,
+						msgpack_object *value)
+{
+	const char *tag = "[wal][apply]";
+	grn_obj *walValue = &(buffers->walValue);
+
+	switch (value->type)
+	{
+	case MSGPACK_OBJECT_BOOLEAN:
+		grn_obj_reinit(ctx, walValue, GRN_DB_BOOL, 0);
+		GRN_BOOL_SET(ctx, walValue, value->via.boolean);
+		break;
+	case MSGPACK_OBJECT_POSITIVE_INTEGER:
+		grn_obj_reinit(ctx, walValue, GRN_DB_UINT64, 0);
+		GRN_UINT64_SET(ctx, walValue, value->via.u64);
+		break;
+	case MSGPACK_OBJECT_NEGATIVE_INTEGER:
+		grn_obj_reinit(ctx, walValue, GRN_DB_INT64, 0);
+		GRN_INT64_SET(ctx, walValue, value->via.i64);
+		break;
+	case MSGPACK_OBJECT_FLOAT32:
+		grn_obj_reinit(ctx, walValue, GRN_DB_FLOAT32, 0);
+		GRN_FLOAT32_SET(ctx, walValue, value->via.f64);
+		break;
+	case MSGPACK_OBJECT_FLOAT64:
+		grn_obj_reinit(ctx, walValue, GRN_DB_FLOAT, 0);
+		GRN_FLOAT_SET(ctx, walValue, value->via.f64);
+		break;
+	case MSGPACK_OBJECT_STR:
+		grn_obj_reinit(ctx, walValue, GRN_DB_TEXT, 0);
+		GRN_TEXT_SET(ctx, walValue, value->via.str.ptr, value->via.str.size);
+		break;
+	case MSGPACK_OBJECT_ARRAY:
+		PGrnWALApplyInsertArray(data,
+								&(value->via.array),
+								walValue,
+								grn_obj_get_range(ctx, column));
+		break;
+		/*
+			case MSGPACK_OBJECT_MAP:
+				break;
+			case MSGPACK_OBJECT_BIN:
+				break;
+			case MSGPACK_OBJECT_EXT:
+				break;
+		*/
+	default:
+		PGrnCheckRC(GRN_INVALID_ARGUMENT,
+					"%s%s[%s(%u)] unexpected value type: <%#x>",
+					tag,
+					context,
+					RelationGetRelationName(data->index),
+					RelationGetRelid(data->index),
+					value->type);
+		break;
+	}
+	grn_obj_set_value(ctx, column, id, walValue, GRN_OBJ_SET);
+}
+
 static void
 PGrnWALApplyInsert(PGrnWALApplyData *data,
 				   msgpack_object_map *map,
@@ -2350,6 +3217,8 @@ PGrnWALApplyInsert(PGrnWALApplyData *data,
 			data->sources = PGrnLookupSourcesTable(data->index, ERROR);
 		table = data->sources;
 	}
+	/* Records in a table without key are added again on replay. */
+	data->replayable = (table->header.type != GRN_TABLE_NO_KEY);
 
 	if (currentElement < map->size)
 	{
@@ -2370,7 +3239,6 @@ PGrnWALApplyInsert(PGrnWALApplyData *data,
 		msgpack_object *key;
 		msgpack_object *value;
 		grn_obj *column;
-		grn_obj *walValue = &(buffers->walValue);
 
 		key = &(map->ptr[i].key);
 		value = &(map->ptr[i].val);
@@ -2388,58 +3256,7 @@ PGrnWALApplyInsert(PGrnWALApplyData *data,
 
 		column = PGrnLookupColumnWithSize(
 			table, key->via.str.ptr, key->via.str.size, ERROR);
-		switch (value->type)
-		{
-		case MSGPACK_OBJECT_BOOLEAN:
-			grn_obj_reinit(ctx, walValue, GRN_DB_BOOL, 0);
-			GRN_BOOL_SET(ctx, walValue, value->via.boolean);
-			break;
-		case MSGPACK_OBJECT_POSITIVE_INTEGER:
-			grn_obj_reinit(ctx, walValue, GRN_DB_UINT64, 0);
-			GRN_UINT64_SET(ctx, walValue, value->via.u64);
-			break;
-		case MSGPACK_OBJECT_NEGATIVE_INTEGER:
-			grn_obj_reinit(ctx, walValue, GRN_DB_INT64, 0);
-			GRN_INT64_SET(ctx, walValue, value->via.i64);
-			break;
-		case MSGPACK_OBJECT_FLOAT32:
-			grn_obj_reinit(ctx, walValue, GRN_DB_FLOAT32, 0);
-			GRN_FLOAT32_SET(ctx, walValue, value->via.f64);
-			break;
-		case MSGPACK_OBJECT_FLOAT64:
-			grn_obj_reinit(ctx, walValue, GRN_DB_FLOAT, 0);
-			GRN_FLOAT_SET(ctx, walValue, value->via.f64);
-			break;
-		case MSGPACK_OBJECT_STR:
-			grn_obj_reinit(ctx, walValue, GRN_DB_TEXT, 0);
-			GRN_TEXT_SET(
-				ctx, walValue, value->via.str.ptr, value->via.str.size);
-			break;
-		case MSGPACK_OBJECT_ARRAY:
-			PGrnWALApplyInsertArray(data,
-									&(value->via.array),
-									walValue,
-									grn_obj_get_range(ctx, column));
-			break;
-			/*
-					case MSGPACK_OBJECT_MAP:
-						break;
-					case MSGPACK_OBJECT_BIN:
-						break;
-					case MSGPACK_OBJECT_EXT:
-						break;
-			*/
-		default:
-			PGrnCheckRC(GRN_INVALID_ARGUMENT,
-						"%s%s[%s(%u)] unexpected value type: <%#x>",
-						tag,
-						context,
-						RelationGetRelationName(data->index),
-						RelationGetRelid(data->index),
-						value->type);
-			break;
-		}
-		grn_obj_set_value(ctx, column, id, walValue, GRN_OBJ_SET);
+		PGrnWALApplyInsertValue(data, context, column, id, value);
 	}
 }
 
@@ -2603,6 +3420,36 @@ PGrnWALApplyRenameTable(PGrnWALApplyData *data,
 	grn_table_rename(ctx, table, newName, newNameSize);
 }
 
+static void
+PGrnWALApplyDeleteKey(grn_obj *table, const char *key, size_t keySize)
+{
+	if (table->header.type == GRN_TABLE_NO_KEY)
+	{
+		const uint64_t packedCtid = *((uint64_t *) key);
+		grn_obj *ctidColumn =
+			grn_obj_column(ctx, table, "ctid", strlen("ctid"));
+		grn_obj ctidValue;
+		GRN_UINT64_INIT(&ctidValue, 0);
+		GRN_TABLE_EACH_BEGIN(ctx, table, cursor, id)
+		{
+			GRN_BULK_REWIND(&ctidValue);
+			grn_obj_get_value(ctx, ctidColumn, id, &ctidValue);
+			if (packedCtid == GRN_UINT64_VALUE(&ctidValue))
+			{
+				grn_table_cursor_delete(ctx, cursor);
+				break;
+			}
+		}
+		GRN_TABLE_EACH_END(ctx, cursor);
+		GRN_OBJ_FIN(ctx, &ctidValue);
+		grn_obj_unlink(ctx, ctidColumn);
+	}
+	else
+	{
+		grn_table_delete(ctx, table, key, keySize);
+	}
+}
+
 static void
 PGrnWALApplyDelete(PGrnWALApplyData *data,
 				   msgpack_object_map *map,
@@ -2630,31 +3477,97 @@ PGrnWALApplyDelete(PGrnWALApplyData *data,
 		}
 	}
 
+	PGrnWALApplyDeleteKey(table, key, keySize);
+}
+
+static void
+PGrnWALApplyBulkDeleteKeys(grn_obj *table, const char *keys, size_t nKeys)
+{
+	const char *tag = "[wal][apply][bulk-delete]";
+	size_t i;
+
 	if (table->header.type == GRN_TABLE_NO_KEY)
 	{
-		const uint64_t packedCtid = *((uint64_t *) key);
-		grn_obj *ctidColumn =
-			grn_obj_column(ctx, table, "ctid", strlen("ctid"));
+		grn_obj *ctidColumn;
 		grn_obj ctidValue;
+		grn_hash *packedCtids;
+
+		packedCtids = grn_hash_create(
+			ctx, NULL, sizeof(uint64_t), 0, GRN_TABLE_HASH_KEY);
+		PGrnCheck("%s failed to create a packed ctids buffer", tag);
+		for (i = 0; i < nKeys; i++)
+		{
+			grn_hash_add(ctx,
+						 packedCtids,
+						 keys + (sizeof(uint64_t) * i),
+						 sizeof(uint64_t),
+						 NULL,
+						 NULL);
+		}
+		ctidColumn = grn_obj_column(ctx, table, "ctid", strlen("ctid"));
 		GRN_UINT64_INIT(&ctidValue, 0);
 		GRN_TABLE_EACH_BEGIN(ctx, table, cursor, id)
 		{
+			uint64_t packedCtid;
+
 			GRN_BULK_REWIND(&ctidValue);
 			grn_obj_get_value(ctx, ctidColumn, id, &ctidValue);
-			if (packedCtid == GRN_UINT64_VALUE(&ctidValue))
+			if (GRN_BULK_VSIZE(&ctidValue) == 0)
+				continue;
+			packedCtid = GRN_UINT64_VALUE(&ctidValue);
+			if (grn_hash_get(ctx,
+							 packedCtids,
+							 &packedCtid,
+							 sizeof(uint64_t),
+							 NULL) != GRN_ID_NIL)
 			{
 				grn_table_cursor_delete(ctx, cursor);
-				break;
 			}
 		}
 		GRN_TABLE_EACH_END(ctx, cursor);
 		GRN_OBJ_FIN(ctx, &ctidValue);
 		grn_obj_unlink(ctx, ctidColumn);
+		grn_hash_close(ctx, packedCtids);
 	}
 	else
 	{
-		grn_table_delete(ctx, table, key, keySize);
+		for (i = 0; i < nKeys; i++)
+		{
+			grn_table_delete(
+				ctx, table, keys + (sizeof(uint64_t) * i), sizeof(uint64_t));
+		}
+	}
+}
+
+static void
+PGrnWALApplyBulkDelete(PGrnWALApplyData *data,
+					   msgpack_object_map *map,
+					   uint32_t currentElement)
+{
+	const char *context = "[bulk-delete]";
+	grn_obj *table = NULL;
+	const char *keys = NULL;
+	size_t keysSize = 0;
+	size_t nKeys;
+	size_t i;
+
+	for (i = currentElement; i < map->size; i++)
+	{
+		msgpack_object_kv *kv;
+
+		kv = &(map->ptr[i]);
+		if (PGrnWALApplyKeyEqual(data, context, &(kv->key), "table"))
+		{
+			table = PGrnWALApplyValueGetGroongaObject(data, context, kv);
+		}
+		else if (PGrnWALApplyKeyEqual(data, context, &(kv->key), "keys"))
+		{
+			PGrnWALApplyValueGetBinary(data, context, kv, &keys, &keysSize);
+		}
 	}
+
+	nKeys = keysSize / sizeof(uint64_t);
+	PGrnWALApplyBulkDeleteKeys(table, keys, nKeys);
 }
 
 static void
@@ -2683,6 +3596,7 @@ PGrnWALApplyRemoveObject(PGrnWALApplyData *data,
 	object = PGrnLookupWithSize(name, nameSize, PGRN_ERROR_LEVEL_IGNORE);
 	if (object)
 	{
+		PGrnIndexCacheInvalidate();
 		grn_obj_remove(ctx, object);
 		PGrnCheck("%s failed to remove: <%.*s>", tag, (int) nameSize, name);
 	}
@@ -2713,6 +3627,271 @@ PGrnWALApplyRegisterPlugin(PGrnWALApplyData *data,
 	PGrnRegisterPluginWithSize(name, nameSize, tag);
 }
 
+static grn_obj *
+PGrnWALApplyCompactGetTable(PGrnWALApplyData *data,
+							const char *context,
+							msgpack_object *object)
+{
+	const char *tag = "[wal][apply][compact][table][get]";
+	grn_obj *table = NULL;
+
+	switch (object->type)
+	{
+	case MSGPACK_OBJECT_NIL:
+		if (!data->sources)
+			data->sources = PGrnLookupSourcesTable(data->index, ERROR);
+		table = data->sources;
+		break;
+	case MSGPACK_OBJECT_STR:
+		table = PGrnLookupWithSize(
+			object->via.str.ptr, object->via.str.size, ERROR);
+		break;
+	default:
+		PGrnCheckRC(GRN_INVALID_ARGUMENT,
+					"%s%s[%s(%u)] table must be nil or string: <%#x>",
+					tag,
+					context,
+					RelationGetRelationName(data->index),
+					RelationGetRelid(data->index),
+					object->type);
+		break;
+	}
+
+	return table;
+}
+
+static void
+PGrnWALApplyCompactGetKey(PGrnWALApplyData *data,
+						  const char *context,
+						  msgpack_object *object,
+						  uint64_t *packedCtid,
+						  const char **key,
+						  size_t *keySize)
+{
+	const char *tag = "[wal][apply][compact][key][get]";
+
+	switch (object->type)
+	{
+	case MSGPACK_OBJECT_POSITIVE_INTEGER:
+		*packedCtid = object->via.u64;
+		*key = (const char *) packedCtid;
+		*keySize = sizeof(uint64_t);
+		break;
+	case MSGPACK_OBJECT_BIN:
+		*key = object->via.bin.ptr;
+		*keySize = object->via.bin.size;
+		break;
+	default:
+		PGrnCheckRC(GRN_INVALID_ARGUMENT,
+					"%s%s[%s(%u)] key must be positive integer or binary: "
+					"<%#x>",
+					tag,
+					context,
+					RelationGetRelationName(data->index),
+					RelationGetRelid(data->index),
+					object->type);
+		break;
+	}
+}
+
+static grn_obj *
+PGrnWALApplyCompactGetColumn(PGrnWALApplyData *data,
+							 const char *context,
+							 grn_obj *table,
+							 msgpack_object *object)
+{
+	const char *tag = "[wal][apply][compact][column][get]";
+	TupleDesc desc = RelationGetDescr(data->index);
+	grn_obj *column = NULL;
+
+	switch (object->type)
+	{
+	case MSGPACK_OBJECT_POSITIVE_INTEGER:
+		if (object->via.u64 < 1 || object->via.u64 > (uint64_t) desc->natts)
+		{
+			PGrnCheckRC(GRN_INVALID_ARGUMENT,
+						"%s%s[%s(%u)] unknown attribute: <%" PRIu64 ">",
+						tag,
+						context,
+						RelationGetRelationName(data->index),
+						RelationGetRelid(data->index),
+						object->via.u64);
+		}
+		column = PGrnLookupColumn(
+			table,
+			NameStr(TupleDescAttr(desc, object->via.u64 - 1)->attname),
+			ERROR);
+		break;
+	case MSGPACK_OBJECT_STR:
+		column = PGrnLookupColumnWithSize(
+			table, object->via.str.ptr, object->via.str.size, ERROR);
+		break;
+	default:
+		PGrnCheckRC(GRN_INVALID_ARGUMENT,
+					"%s%s[%s(%u)] column must be positive integer or string: "
+					"<%#x>",
+					tag,
+					context,
+					RelationGetRelationName(data->index),
+					RelationGetRelid(data->index),
+					object->type);
+		break;
+	}
+
+	return column;
+}
+
+static void
+PGrnWALApplyCompactInsert(PGrnWALApplyData *data, msgpack_object_array *array)
+{
+	const char *context = "[compact][insert]";
+	grn_obj *table;
+	uint64_t packedCtid;
+	const char *key = NULL;
+	size_t keySize = 0;
+	grn_id id;
+	uint32_t i = 2;
+
+	table = PGrnWALApplyCompactGetTable(data, context, &(array->ptr[1]));
+	data->replayable = (table->header.type != GRN_TABLE_NO_KEY);
+	if (i + 1 < array->size &&
+		array->ptr[i].type == MSGPACK_OBJECT_POSITIVE_INTEGER &&
+		array->ptr[i].via.u64 == 0)
+	{
+		PGrnWALApplyCompactGetKey(
+			data, context, &(array->ptr[i + 1]), &packedCtid, &key, &keySize);
+		i += 2;
+	}
+
+	id = grn_table_add(ctx, table, key, keySize, NULL);
+	for (; i + 1 < array->size; i += 2)
+	{
+		grn_obj *column;
+
+		column = PGrnWALApplyCompactGetColumn(
+			data, context, table, &(array->ptr[i]));
+		PGrnWALApplyInsertValue(
+			data, context, column, id, &(array->ptr[i + 1]));
+	}
+}
+
+static void
+PGrnWALApplyCompactDelete(PGrnWALApplyData *data, msgpack_object_array *array)
+{
+	const char *context = "[compact][delete]";
+	grn_obj *table;
+	uint64_t packedCtid;
+	const char *key = NULL;
+	size_t keySize = 0;
+
+	table = PGrnWALApplyCompactGetTable(data, context, &(array->ptr[1]));
+	PGrnWALApplyCompactGetKey(
+		data, context, &(array->ptr[2]), &packedCtid, &key, &keySize);
+	PGrnWALApplyDeleteKey(table, key, keySize);
+}
+
+static void
+PGrnWALApplyCompactBulkDelete(PGrnWALApplyData *data,
+							  msgpack_object_array *array)
+{
+	const char *tag = "[wal][apply]";
+	const char *context = "[compact][bulk-delete]";
+	grn_obj *table;
+	msgpack_object_array *deltas;
+	uint64_t *packedCtids;
+	uint64_t packedCtid = 0;
+	uint32_t i;
+
+	table = PGrnWALApplyCompactGetTable(data, context, &(array->ptr[1]));
+	if (array->ptr[2].type != MSGPACK_OBJECT_ARRAY)
+	{
+		PGrnCheckRC(GRN_INVALID_ARGUMENT,
+					"%s%s[%s(%u)] keys must be array: <%#x>",
+					tag,
+					context,
+					RelationGetRelationName(data->index),
+					RelationGetRelid(data->index),
+					array->ptr[2].type);
+	}
+
+	deltas = &(array->ptr[2].via.array);
+	packedCtids = palloc(sizeof(uint64_t) * Max(deltas->size, 1));
+	for (i = 0; i < deltas->size; i++)
+	{
+		if (deltas->ptr[i].type != MSGPACK_OBJECT_POSITIVE_INTEGER)
+		{
+			PGrnCheckRC(GRN_INVALID_ARGUMENT,
+						"%s%s[%s(%u)] key must be positive integer: <%#x>",
+						tag,
+						context,
+						RelationGetRelationName(data->index),
+						RelationGetRelid(data->index),
+						deltas->ptr[i].type);
+		}
+		packedCtid += deltas->ptr[i].via.u64;
+		packedCtids[i] = packedCtid;
+	}
+	PGrnWALApplyBulkDeleteKeys(table, (const char *) packedCtids, deltas->size);
+	pfree(packedCtids);
+}
+
+static void
+PGrnWALApplyCompactObject(PGrnWALApplyData *data, msgpack_object_array *array)
+{
+	const char *tag = "[wal][apply][object][compact]";
+	PGrnWALAction action;
+	uint32_t minSize = 2;
+
+	if (array->size < 1 ||
+		array->ptr[0].type != MSGPACK_OBJECT_POSITIVE_INTEGER)
+	{
+		PGrnCheckRC(GRN_INVALID_ARGUMENT,
+					"%s[%s(%u)] record must start with action: <%u>",
+					tag,
+					RelationGetRelationName(data->index),
+					RelationGetRelid(data->index),
+					array->size);
+	}
+
+	action = array->ptr[0].via.u64;
+	if (action == PGRN_WAL_ACTION_DELETE ||
+		action == PGRN_WAL_ACTION_BULK_DELETE)
+		minSize = 3;
+	if (array->size < minSize)
+	{
+		PGrnCheckRC(GRN_INVALID_ARGUMENT,
+					"%s[%s(%u)] too few elements: <%d>: <%u>",
+					tag,
+					RelationGetRelationName(data->index),
+					RelationGetRelid(data->index),
+					action,
+					array->size);
+	}
+
+	switch (action)
+	{
+	case PGRN_WAL_ACTION_INSERT:
+		PGrnWALApplyCompactInsert(data, array);
+		break;
+	case PGRN_WAL_ACTION_DELETE:
+		PGrnWALApplyCompactDelete(data, array);
+		data->replayable = true;
+		break;
+	case PGRN_WAL_ACTION_BULK_DELETE:
+		PGrnWALApplyCompactBulkDelete(data, array);
+		data->replayable = true;
+		break;
+	default:
+		PGrnCheckRC(GRN_INVALID_ARGUMENT,
+					"%s[%s(%u)] unexpected action: <%d>",
+					tag,
+					RelationGetRelationName(data->index),
+					RelationGetRelid(data->index),
+					action);
+		break;
+	}
+}
+
 static void
 PGrnWALApplyObject(PGrnWALApplyData *data, msgpack_object *object)
 {
@@ -2722,6 +3901,14 @@ PGrnWALApplyObject(PGrnWALApplyData *data, msgpack_object *object)
 	uint32_t currentElement = 0;
 	PGrnWALAction action = PGRN_WAL_ACTION_INSERT;
 
+	data->replayable = false;
+
+	if (object->type == MSGPACK_OBJECT_ARRAY)
+	{
+		PGrnWALApplyCompactObject(data, &(object->via.array));
+		return;
+	}
+
 	if (object->type != MSGPACK_OBJECT_MAP)
 	{
 		const char *message = "record must be map";
@@ -2811,17 +3998,6 @@ PGrnWALApplyObject(PGrnWALApplyData *data, msgpack_object *object)
 						(int) object->via.str.size,
 						object->via.str.ptr);
 			break;
-		case MSGPACK_OBJECT_ARRAY:
-			PGrnCheckRC(GRN_INVALID_ARGUMENT,
-						"%s[%s(%u)] %s: <%u><%u>: <array>: <%u>",
-						tag,
-						RelationGetRelationName(data->index),
-						RelationGetRelid(data->index),
-						message,
-						currentBlock,
-						currentOffset,
-						object->via.array.size);
-			break;
 #	if MSGPACK_VERSION_MAJOR != 0
 		case MSGPACK_OBJECT_BIN:
 			PGrnCheckRC(GRN_INVALID_ARGUMENT,
@@ -2882,6 +4058,7 @@ PGrnWALApplyObject(PGrnWALApplyData *data, msgpack_object *object)
 		break;
 	case PGRN_WAL_ACTION_DELETE:
 		PGrnWALApplyDelete(data, map, currentElement);
+		data->replayable = true;
 		break;
 	case PGRN_WAL_ACTION_REMOVE_OBJECT:
 		PGrnWALApplyRemoveObject(data, map, currentElement);
@@ -2889,6 +4066,10 @@ PGrnWALApplyObject(PGrnWALApplyData *data, msgpack_object *object)
 	case PGRN_WAL_ACTION_REGISTER_PLUGIN:
 		PGrnWALApplyRegisterPlugin(data, map, currentElement);
 		break;
+	case PGRN_WAL_ACTION_BULK_DELETE:
+		PGrnWALApplyBulkDelete(data, map, currentElement);
+		data->replayable = true;
+		break;
 	default:
 		PGrnCheckRC(GRN_INVALID_ARGUMENT,
 					"%s[%s(%u)] unexpected action: <%d>",
@@ -2916,6 +4097,9 @@ PGrnWALApplyConsume(PGrnWALApplyData *data)
 	msgpack_unpacker unpacker;
 	msgpack_unpacked unpacked;
 	size_t bufferedSize = 0;
+	BlockNumber pendingBlock = InvalidBlockNumber;
+	LocationIndex pendingOffset = 0;
+	int nPendingOperations = 0;
 
 	msgpack_unpacker_init(&unpacker, MSGPACK_UNPACKER_INIT_BUFFER_SIZE);
 	msgpack_unpacked_init(&unpacked);
@@ -2923,6 +4107,8 @@ PGrnWALApplyConsume(PGrnWALApplyData *data)
 		data->index, PGRN_WAL_META_PAGE_BLOCK_NUMBER, BUFFER_LOCK_SHARE);
 	metaPage = BufferGetPage(metaBuffer);
 	meta = (PGrnWALMetaPageSpecial *) PageGetSpecialPointer(metaPage);
+	/* Writers can't update WAL while we have the meta page. */
+	data->lsn = PageGetLSN(metaPage);
 	startBlock = data->current.block;
 	dataOffset = data->current.offset;
 	if (startBlock == PGRN_WAL_META_PAGE_BLOCK_NUMBER)
@@ -2934,6 +4120,18 @@ PGrnWALApplyConsume(PGrnWALApplyData *data)
 		maxBlock = nBlocks;
 	PG_TRY();
 	{
+		if (meta->version > PGRN_WAL_META_PAGE_SPECIAL_VERSION)
+		{
+			PGrnCheckRC(GRN_FUNCTION_NOT_IMPLEMENTED,
+						"[wal][apply][consume][%s(%u)] "
+						"unsupported WAL format version: <%u>: "
+						"supported version: <%u>: "
+						"PGroonga should be upgraded",
+						RelationGetRelationName(data->index),
+						RelationGetRelid(data->index),
+						meta->version,
+						PGRN_WAL_META_PAGE_SPECIAL_VERSION);
+		}
 		for (i = 0; i < nBlocks; i++)
 		{
 			BlockNumber block;
@@ -3014,9 +4212,34 @@ PGrnWALApplyConsume(PGrnWALApplyData *data)
 				PGrnWALApplyObject(data, &unpacked.data);
 				bufferedSize -= parsedSize;
 				appliedOffset = dataOffset + dataSize - bufferedSize;
-				PGrnIndexStatusSetWALAppliedPosition(
-					data->index, block, appliedOffset);
 				nAppliedOperations++;
+				/*
+				 * Updating the applied position for each record is
+				 * slow. We defer it while applied records can be
+				 * applied again safely. If we fail before we update
+				 * it, the deferred records are just applied again.
+				 */
+				if (data->replayable &&
+					nPendingOperations + 1 <
+						PGrnWALAppliedPositionUpdateInterval)
+				{
+					pendingBlock = block;
+					pendingOffset = appliedOffset;
+					nPendingOperations++;
+				}
+				else
+				{
+					PGrnIndexStatusSetWALAppliedPosition(
+						data->index, block, appliedOffset);
+					nPendingOperations = 0;
+				}
+			}
+
+			if (nPendingOperations > 0)
+			{
+				PGrnIndexStatusSetWALAppliedPosition(
+					data->index, pendingBlock, pendingOffset);
+				nPendingOperations = 0;
 			}
 
 			if (block == nextBlock)
@@ -3061,11 +4284,51 @@ PGrnWALApply(Relation index)
 		data.index, &(data.current.block), &(data.current.offset));
 	data.sources = NULL;
 	nAppliedOperations = PGrnWALApplyConsume(&data);
+	PGrnWALApplyStatusSetApplied(index, data.lsn);
 	PGrnWALUnlock(index);
 #endif
 	return nAppliedOperations;
 }
 
+/*
+ * This is for search. This doesn't apply WAL when all WAL were
+ * applied within pgroonga.max_wal_apply_delay. WAL are applied by
+ * pgroonga_wal_applier or pgroonga_standby_maintainer in this
+ * case. So search results may not include changes in the last
+ * pgroonga.max_wal_apply_delay. pgroonga_wal_applier is woken up to
+ * apply them soon.
+ *
+ * Don't use this before writing. Writing marks all WAL as applied.
+ */
+int64_t
+PGrnWALApplyDeferrable(Relation index)
+{
+#ifdef PGRN_SUPPORT_WAL
+	if (!PGrnWALEnabled)
+		return 0;
+
+	if (PGrnWALMaxApplyDelay >= 0)
+	{
+		TimestampTz appliedTime;
+
+		if (PGrnWALApplyStatusIsApplied(index, &appliedTime))
+			return 0;
+		if (appliedTime != 0 &&
+			!TimestampDifferenceExceeds(
+				appliedTime, GetCurrentTimestamp(), PGrnWALMaxApplyDelay))
+		{
+			/* There may be pending WAL. Ask pgroonga_wal_applier to
+			 * apply them soon. */
+			if (PGrnWALApplierStatuses)
+				pgrn_wal_applier_statuses_request(PGrnWALApplierStatuses,
+												  MyDatabaseId);
+			return 0;
+		}
+	}
+#endif
+	return PGrnWALApply(index);
+}
+
 /**
  * pgroonga_wal_apply(indexName cstring) : bigint
  */
@@ -3596,6 +4859,7 @@ pgroonga_wal_set_applied_position_index(PG_FUNCTION_ARGS)
 		}
 		PGrnWALLock(index);
 		PGrnIndexStatusSetWALAppliedPosition(index, block, offset);
+		PGrnWALApplyStatusReset(index);
 		PGrnWALUnlock(index);
 	}
 	PG_CATCH();
@@ -3667,6 +4931,7 @@ pgroonga_wal_set_applied_position_index_last(PG_FUNCTION_ARGS)
 		PGrnWALLock(index);
 		PGrnWALGetLastPosition(index, &block, &offset);
 		PGrnIndexStatusSetWALAppliedPosition(index, block, offset);
+		PGrnWALApplyStatusReset(index);
 		PGrnWALUnlock(index);
 	}
 	PG_CATCH();
@@ -3728,6 +4993,7 @@ pgroonga_wal_set_applied_position_all(PG_FUNCTION_ARGS)
 		{
 			PGrnWALLock(index);
 			PGrnIndexStatusSetWALAppliedPosition(index, block, offset);
+			PGrnWALApplyStatusReset(index);
 			PGrnWALUnlock(index);
 		}
 		PG_CATCH();
@@ -3800,6 +5066,7 @@ pgroonga_wal_set_applied_position_all_last(PG_FUNCTION_ARGS)
 			PGrnWALLock(index);
 			PGrnWALGetLastPosition(index, &block, &offset);
 			PGrnIndexStatusSetWALAppliedPosition(index, block, offset);
+			PGrnWALApplyStatusReset(index);
 			PGrnWALUnlock(index);
 		}
 		PG_CATCH();
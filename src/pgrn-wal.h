@@ -24,6 +24,19 @@ bool PGrnWALResourceManagerIsOnlyEnabled(void);
 size_t PGrnWALGetMaxBulkInsertRecordSize(void);
 void PGrnWALSetMaxBulkInsertRecordSize(size_t size);
 
+bool PGrnWALGroupCommitGetEnabled(void);
+void PGrnWALGroupCommitEnable(void);
+void PGrnWALGroupCommitDisable(void);
+
+int PGrnWALGetAppliedPositionUpdateInterval(void);
+void PGrnWALSetAppliedPositionUpdateInterval(int interval);
+
+int PGrnWALGetMaxApplyDelay(void);
+void PGrnWALSetMaxApplyDelay(int delay);
+
+Size PGrnWALSharedMemorySize(void);
+void PGrnInitializeWAL(void);
+
 PGrnWALData *PGrnWALStart(Relation index);
 void PGrnWALFinish(PGrnWALData *data);
 void PGrnWALAbort(PGrnWALData *data);
@@ -66,6 +79,7 @@ void PGrnWALRenameTable(Relation index,
 
 void
 PGrnWALDelete(Relation index, grn_obj *table, const char *key, size_t keySize);
+void PGrnWALBulkDelete(Relation index, grn_obj *table, grn_obj *packedCtids);
 
 void PGrnWALRemoveObject(Relation index, const char *name, size_t nameSize);
 
@@ -73,3 +87,4 @@ void PGrnWALRegisterPlugin(Relation index, const char *name, size_t nameSize);
 void PGrnWALRegisterPlugins(Relation index, grn_obj *names);
 
 int64_t PGrnWALApply(Relation index);
+int64_t PGrnWALApplyDeferrable(Relation index);
@@ -1,25 +1,31 @@
 #include "pgrn-compatible.h"
+#include "pgrn-wal-applier-statuses.h"
 
 #include <access/heapam.h>
 #include <access/relscan.h>
 #include <access/tableam.h>
 #include <access/xact.h>
 #include <catalog/pg_database.h>
+#include <catalog/pg_type.h>
 #include <executor/spi.h>
 #include <fmgr.h>
 #include <miscadmin.h>
+#include <nodes/pg_list.h>
 #include <pgstat.h>
 #include <postmaster/bgworker.h>
 #include <storage/ipc.h>
 #include <storage/latch.h>
 #include <utils/guc.h>
 #include <utils/snapmgr.h>
+#include <utils/timestamp.h>
 
 PG_MODULE_MAGIC;
 
 extern PGDLLEXPORT void _PG_init(void);
 extern PGDLLEXPORT pg_noreturn void pgroonga_wal_applier_apply(Datum datum)
 	pg_attribute_noreturn();
+extern PGDLLEXPORT pg_noreturn void
+pgroonga_wal_applier_apply_index(Datum datum) pg_attribute_noreturn();
 extern PGDLLEXPORT pg_noreturn void pgroonga_wal_applier_main(Datum datum)
 	pg_attribute_noreturn();
 
@@ -28,7 +34,12 @@ extern PGDLLEXPORT pg_noreturn void pgroonga_wal_applier_main(Datum datum)
 static volatile sig_atomic_t PGroongaWALApplierGotSIGTERM = false;
 static volatile sig_atomic_t PGroongaWALApplierGotSIGHUP = false;
 static int PGroongaWALApplierNaptime = 60;
+static int PGroongaWALApplierMaxParallelDatabases = 1;
+static int PGroongaWALApplierMaxParallelWALAppliersPerDB = 0;
 static const char *PGroongaWALApplierLibraryName = "pgroonga_wal_applier";
+#if PG_VERSION_NUM >= 150000
+static shmem_request_hook_type PreviousShmemRequestHook = NULL;
+#endif
 
 static void
 pgroonga_wal_applier_sigterm(SIGNAL_ARGS)
@@ -52,10 +63,197 @@ pgroonga_wal_applier_sighup(SIGNAL_ARGS)
 	errno = save_errno;
 }
 
+/*
+ * char bgw_extra[BGW_EXTRALEN]
+ *
+ * * The first 4 bytes are used for index OID
+ */
+#define BGWORKER_GET_INDEX_OID(worker) (*((Oid *) ((worker)->bgw_extra)))
+#define BGWORKER_SET_INDEX_OID(worker, oid)                                    \
+	*((Oid *) ((worker)->bgw_extra)) = (oid)
+
+/*
+ * Waits until the number of running workers is less than
+ * maxRunningWorkers. Handles of stopped workers in handles are
+ * replaced with NULL.
+ */
+static void
+pgroonga_wal_applier_wait_workers(List *handles,
+								  int *nRunningWorkers,
+								  int maxRunningWorkers)
+{
+	while (*nRunningWorkers >= maxRunningWorkers)
+	{
+		ListCell *cell;
+
+		foreach (cell, handles)
+		{
+			BackgroundWorkerHandle *handle = lfirst(cell);
+			pid_t pid;
+			BgwHandleStatus status;
+
+			if (!handle)
+				continue;
+
+			status = GetBackgroundWorkerPid(handle, &pid);
+			if (status == BGWH_STOPPED)
+			{
+				lfirst(cell) = NULL;
+				(*nRunningWorkers)--;
+			}
+		}
+		if (*nRunningWorkers < maxRunningWorkers)
+			break;
+
+		WaitLatch(MyLatch,
+				  WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+				  60 * 1000,
+				  WAIT_EVENT_BGWORKER_SHUTDOWN);
+		ResetLatch(MyLatch);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+void
+pgroonga_wal_applier_apply_index(Datum databaseOidDatum)
+{
+	Oid databaseOid = DatumGetObjectId(databaseOidDatum);
+	Oid indexOid = BGWORKER_GET_INDEX_OID(MyBgworkerEntry);
+
+	BackgroundWorkerUnblockSignals();
+
+	BackgroundWorkerInitializeConnectionByOid(databaseOid, InvalidOid, 0);
+
+	StartTransactionCommand();
+	SPI_connect();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	pgstat_report_activity(STATE_RUNNING, TAG ": applying index");
+
+	{
+		SPIPlanPtr plan;
+		int nArgs = 1;
+		Oid argTypes[1] = {OIDOID};
+		Datum args[1] = {ObjectIdGetDatum(indexOid)};
+		char nulls[1] = {' '};
+		int result;
+
+		SetCurrentStatementStartTimestamp();
+		plan = SPI_prepare(
+			"SELECT pgroonga_wal_apply($1::regclass::text::cstring)",
+			nArgs,
+			argTypes);
+		result = SPI_execute_plan(plan, args, nulls, false, 0);
+		if (result != SPI_OK_SELECT)
+		{
+			ereport(FATAL,
+					(errmsg(TAG ": failed to apply WAL: %u/%u: %d",
+							databaseOid,
+							indexOid,
+							result)));
+		}
+	}
+
+	PopActiveSnapshot();
+	SPI_finish();
+	CommitTransactionCommand();
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	proc_exit(0);
+}
+
+static void
+pgroonga_wal_applier_apply_indexes(Oid databaseOid)
+{
+	int result;
+	int nRunningWorkers = 0;
+	List *handles = NIL;
+	uint64 i;
+	uint64 nIndexes;
+	Oid *indexOids;
+
+	SetCurrentStatementStartTimestamp();
+	result = SPI_execute("SELECT class.oid AS index_oid "
+						 "  FROM pg_catalog.pg_class AS class "
+						 " WHERE class.relam = ("
+						 "   SELECT oid "
+						 "     FROM pg_catalog.pg_am "
+						 "    WHERE amname = 'pgroonga'"
+						 " )",
+						 true,
+						 0);
+	if (result != SPI_OK_SELECT)
+	{
+		ereport(FATAL,
+				(errmsg(TAG ": failed to detect PGroonga indexes: %u: %d",
+						databaseOid,
+						result)));
+	}
+
+	nIndexes = SPI_processed;
+	indexOids = palloc(sizeof(Oid) * Max(nIndexes, 1));
+	for (i = 0; i < nIndexes; i++)
+	{
+		bool isNull;
+		Datum indexOidDatum;
+
+		indexOidDatum = SPI_getbinval(
+			SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isNull);
+		indexOids[i] = isNull ? InvalidOid : DatumGetObjectId(indexOidDatum);
+	}
+
+	for (i = 0; i < nIndexes; i++)
+	{
+		BackgroundWorker worker = {0};
+		BackgroundWorkerHandle *handle;
+
+		if (!OidIsValid(indexOids[i]))
+			continue;
+
+		snprintf(worker.bgw_name,
+				 BGW_MAXLEN,
+				 TAG ": apply index: %u/%u",
+				 databaseOid,
+				 indexOids[i]);
+		snprintf(worker.bgw_type, BGW_MAXLEN, "%s", worker.bgw_name);
+		worker.bgw_flags =
+			BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+		worker.bgw_start_time = BgWorkerStart_ConsistentState;
+		worker.bgw_restart_time = BGW_NEVER_RESTART;
+		snprintf(worker.bgw_library_name,
+				 BGW_MAXLEN,
+				 "%s",
+				 PGroongaWALApplierLibraryName);
+		snprintf(worker.bgw_function_name,
+				 BGW_MAXLEN,
+				 "pgroonga_wal_applier_apply_index");
+		worker.bgw_main_arg = ObjectIdGetDatum(databaseOid);
+		worker.bgw_notify_pid = MyProcPid;
+		BGWORKER_SET_INDEX_OID(&worker, indexOids[i]);
+
+		pgroonga_wal_applier_wait_workers(
+			handles,
+			&nRunningWorkers,
+			PGroongaWALApplierMaxParallelWALAppliersPerDB);
+		if (!RegisterDynamicBackgroundWorker(&worker, &handle))
+			continue;
+		handles = lappend(handles, handle);
+		nRunningWorkers++;
+	}
+	/* Wait for all workers. */
+	pgroonga_wal_applier_wait_workers(handles, &nRunningWorkers, 1);
+
+	list_free(handles);
+	pfree(indexOids);
+}
+
 void
 pgroonga_wal_applier_apply(Datum databaseOidDatum)
 {
 	Oid databaseOid = DatumGetObjectId(databaseOidDatum);
+
+	BackgroundWorkerUnblockSignals();
+
 	BackgroundWorkerInitializeConnectionByOid(databaseOid, InvalidOid, 0);
 
 	StartTransactionCommand();
@@ -81,12 +279,19 @@ pgroonga_wal_applier_apply(Datum databaseOidDatum)
 		}
 		if (SPI_processed == 1)
 		{
-			SetCurrentStatementStartTimestamp();
-			result = SPI_execute("select pgroonga_wal_apply()", true, 0);
-			if (result != SPI_OK_SELECT)
+			if (PGroongaWALApplierMaxParallelWALAppliersPerDB > 0)
 			{
-				ereport(FATAL,
-						(errmsg(TAG ": failed to apply WAL: %d", result)));
+				pgroonga_wal_applier_apply_indexes(databaseOid);
+			}
+			else
+			{
+				SetCurrentStatementStartTimestamp();
+				result = SPI_execute("select pgroonga_wal_apply()", true, 0);
+				if (result != SPI_OK_SELECT)
+				{
+					ereport(FATAL,
+							(errmsg(TAG ": failed to apply WAL: %d", result)));
+				}
 			}
 		}
 	}
@@ -99,18 +304,46 @@ pgroonga_wal_applier_apply(Datum databaseOidDatum)
 	proc_exit(0);
 }
 
+static bool
+pgroonga_wal_applier_is_target_database(Oid databaseOid,
+										const Oid *databaseOids,
+										uint32 nDatabases)
+{
+	uint32 i;
+
+	if (!databaseOids)
+		return true;
+
+	for (i = 0; i < nDatabases; i++)
+	{
+		if (databaseOids[i] == databaseOid)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Applies WAL in databaseOids. If databaseOids is NULL, WAL in all
+ * databases are applied.
+ */
 static void
-pgroonga_wal_applier_apply_all(void)
+pgroonga_wal_applier_apply_all(const Oid *databaseOids, uint32 nDatabases)
 {
 	StartTransactionCommand();
 	PushActiveSnapshot(GetTransactionSnapshot());
-	pgstat_report_activity(STATE_RUNNING, TAG ": applying all databases");
+	if (databaseOids)
+		pgstat_report_activity(STATE_RUNNING,
+							   TAG ": applying requested databases");
+	else
+		pgstat_report_activity(STATE_RUNNING, TAG ": applying all databases");
 
 	{
 		const LOCKMODE lock = AccessShareLock;
 		Relation pg_database;
 		TableScanDesc scan;
 		HeapTuple tuple;
+		int nRunningWorkers = 0;
+		List *handles = NIL;
 
 		pg_database = table_open(DatabaseRelationId, lock);
 		scan = table_beginscan_catalog(pg_database, 0, NULL);
@@ -132,6 +365,10 @@ pgroonga_wal_applier_apply_all(void)
 				continue;
 
 			databaseOid = form->oid;
+			if (!pgroonga_wal_applier_is_target_database(
+					databaseOid, databaseOids, nDatabases))
+				continue;
+
 			snprintf(worker.bgw_name,
 					 BGW_MAXLEN,
 					 TAG ": apply: %s(%u)",
@@ -151,12 +388,21 @@ pgroonga_wal_applier_apply_all(void)
 					 "pgroonga_wal_applier_apply");
 			worker.bgw_main_arg = DatumGetObjectId(databaseOid);
 			worker.bgw_notify_pid = MyProcPid;
+			pgroonga_wal_applier_wait_workers(
+				handles,
+				&nRunningWorkers,
+				PGroongaWALApplierMaxParallelDatabases);
 			if (!RegisterDynamicBackgroundWorker(&worker, &handle))
 				continue;
-			WaitForBackgroundWorkerShutdown(handle);
+			handles = lappend(handles, handle);
+			nRunningWorkers++;
 		}
 		table_endscan(scan);
 		table_close(pg_database, lock);
+
+		/* Wait for all workers. */
+		pgroonga_wal_applier_wait_workers(handles, &nRunningWorkers, 1);
+		list_free(handles);
 	}
 
 	PopActiveSnapshot();
@@ -164,37 +410,91 @@ pgroonga_wal_applier_apply_all(void)
 	pgstat_report_activity(STATE_IDLE, NULL);
 }
 
+static void
+pgroonga_wal_applier_main_on_exit(int code, Datum arg)
+{
+	pgrn_wal_applier_statuses_set_main_pid(
+		(pgrn_wal_applier_statuses *) DatumGetPointer(arg), InvalidPid);
+}
+
 void
 pgroonga_wal_applier_main(Datum arg)
 {
+	pgrn_wal_applier_statuses *statuses;
+	TimestampTz lastAppliedAllTime;
+
 	pqsignal(SIGTERM, pgroonga_wal_applier_sigterm);
 	pqsignal(SIGHUP, pgroonga_wal_applier_sighup);
 	BackgroundWorkerUnblockSignals();
 
 	BackgroundWorkerInitializeConnection(NULL, NULL, 0);
 
+	/* Processes that find pending WAL wake us up by SIGUSR1. The
+	 * default SIGUSR1 handler sets our latch. */
+	statuses = pgrn_wal_applier_statuses_get();
+	pgrn_wal_applier_statuses_set_main_pid(statuses, MyProcPid);
+	before_shmem_exit(pgroonga_wal_applier_main_on_exit,
+					  PointerGetDatum(statuses));
+
+	lastAppliedAllTime = GetCurrentTimestamp();
 	while (!PGroongaWALApplierGotSIGTERM)
 	{
-		WaitLatch(MyLatch,
-				  WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-				  PGroongaWALApplierNaptime * 1000L,
-				  PG_WAIT_EXTENSION);
-		ResetLatch(MyLatch);
+		long naptime = PGroongaWALApplierNaptime * 1000L;
+		long timeout;
+		Oid databaseOids[PGRN_WAL_APPLIER_STATUSES_N_DATABASES];
+		uint32 nDatabases;
+
+		timeout = naptime - TimestampDifferenceMilliseconds(
+								lastAppliedAllTime, GetCurrentTimestamp());
+		if (timeout > 0 && !pgrn_wal_applier_statuses_is_requested(statuses))
+		{
+			WaitLatch(MyLatch,
+					  WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+					  timeout,
+					  PG_WAIT_EXTENSION);
+			ResetLatch(MyLatch);
+		}
 
 		CHECK_FOR_INTERRUPTS();
 
+		if (PGroongaWALApplierGotSIGTERM)
+			break;
+
 		if (PGroongaWALApplierGotSIGHUP)
 		{
 			PGroongaWALApplierGotSIGHUP = false;
 			ProcessConfigFile(PGC_SIGHUP);
+			naptime = PGroongaWALApplierNaptime * 1000L;
 		}
 
-		pgroonga_wal_applier_apply_all();
+		if (!pgrn_wal_applier_statuses_take(
+				statuses, databaseOids, &nDatabases) ||
+			TimestampDifferenceExceeds(
+				lastAppliedAllTime, GetCurrentTimestamp(), naptime))
+		{
+			lastAppliedAllTime = GetCurrentTimestamp();
+			pgroonga_wal_applier_apply_all(NULL, 0);
+		}
+		else if (nDatabases > 0)
+		{
+			pgroonga_wal_applier_apply_all(databaseOids, nDatabases);
+		}
 	}
 
 	proc_exit(1);
 }
 
+#if PG_VERSION_NUM >= 150000
+static void
+pgroonga_wal_applier_shmem_request(void)
+{
+	if (PreviousShmemRequestHook)
+		PreviousShmemRequestHook();
+
+	RequestAddinShmemSpace(sizeof(pgrn_wal_applier_statuses));
+}
+#endif
+
 void
 _PG_init(void)
 {
@@ -206,7 +506,11 @@ _PG_init(void)
 							"It means that PGroonga WAL applier tries to "
 							"apply all pending PGroonga WAL "
 							"in all PGroonga available databases "
-							"per 1 minute.",
+							"per 1 minute. "
+							"It's woken up before the naptime only by "
+							"search that skips applying WAL by "
+							"pgroonga.max_wal_apply_delay. "
+							"WAL writers don't wake it up.",
 							&PGroongaWALApplierNaptime,
 							PGroongaWALApplierNaptime,
 							1,
@@ -216,10 +520,47 @@ _PG_init(void)
 							NULL,
 							NULL,
 							NULL);
+	DefineCustomIntVariable(
+		"pgroonga_wal_applier.max_parallel_databases",
+		"The max number of databases that are applied in parallel.",
+		"The default is 1. "
+		"It means that databases are applied one by one.",
+		&PGroongaWALApplierMaxParallelDatabases,
+		PGroongaWALApplierMaxParallelDatabases,
+		1,
+		INT_MAX,
+		PGC_SIGHUP,
+		0,
+		NULL,
+		NULL,
+		NULL);
+	DefineCustomIntVariable(
+		"pgroonga_wal_applier.max_parallel_wal_appliers_per_db",
+		"The max number of parallel WAL applier processes "
+		"per DB.",
+		"The default is 0. "
+		"It means that no parallel WAL applier process "
+		"is used.",
+		&PGroongaWALApplierMaxParallelWALAppliersPerDB,
+		PGroongaWALApplierMaxParallelWALAppliersPerDB,
+		0,
+		INT_MAX,
+		PGC_SIGHUP,
+		0,
+		NULL,
+		NULL,
+		NULL);
 
 	if (!process_shared_preload_libraries_in_progress)
 		return;
 
+#if PG_VERSION_NUM >= 150000
+	PreviousShmemRequestHook = shmem_request_hook;
+	shmem_request_hook = pgroonga_wal_applier_shmem_request;
+#else
+	RequestAddinShmemSpace(sizeof(pgrn_wal_applier_statuses));
+#endif
+
 	snprintf(worker.bgw_name, BGW_MAXLEN, TAG ": main");
 	snprintf(worker.bgw_type, BGW_MAXLEN, "%s", worker.bgw_name);
 	worker.bgw_flags =
@@ -17,6 +17,14 @@ static grn_obj PGrnInspectBuffer;
 #endif
 
 #include <utils/guc.h>
+#ifdef PGRN_SUPPORT_WAL_RESOURCE_MANAGER
+#	include <access/xlog.h>
+#	include <access/xlog_internal.h>
+#	include <catalog/pg_control.h>
+#	include <replication/walreceiver.h>
+#	include <storage/ipc.h>
+#	include <utils/timestamp.h>
+#endif
 
 PG_MODULE_MAGIC;
 
@@ -26,6 +34,7 @@ static int PGrnWRMLogLevel = GRN_LOG_DEFAULT_LEVEL;
 PGRN_DEFINE_LOG_LEVEL_ENTRIES(PGrnWRMLogLevelEntries);
 static Oid PGrnWRMCurrentDatabaseID = InvalidOid;
 static Oid PGrnWRMCurrentDatabaseTableSpaceID = InvalidOid;
+static int PGrnWRMFlushInterval = 0;
 
 extern PGDLLEXPORT void _PG_init(void);
 
@@ -36,6 +45,90 @@ pgrnwrm_get_thread_limit(void *data)
 	return 1;
 }
 
+/*
+ * Flushing Groonga objects for each WAL record is slow. Redo for per
+ * row operations (insert, delete, bulk insert and bulk delete) can
+ * defer it by pgroonga_wal_resource_manager.flush_interval. Deferred
+ * records are flushed:
+ *
+ *   * when the interval is elapsed,
+ *   * when a checkpoint record is replayed,
+ *   * when redo will wait for new WAL,
+ *   * when the target database is changed,
+ *   * when the startup process exits and
+ *   * when recovery is finished.
+ *
+ * Records after the last restartpoint are replayed again after
+ * crash. So we need to flush deferred records before a restartpoint
+ * that covers them is finished. A restartpoint is created only for a
+ * checkpoint record that is already replayed. Checkpoint records
+ * aren't PGroonga WAL records. So we wrap the redo of the built-in
+ * XLOG resource manager and flush deferred records before a
+ * checkpoint record is replayed. See pgrnwrm_xlog_redo().
+ *
+ * We can't run anything while redo waits for new WAL. So we also
+ * flush deferred records before redo waits for new WAL to reduce
+ * the delay of flushing.
+ */
+static bool PGrnWRMFlushDeferred = false;
+static TimestampTz PGrnWRMLastFlushTime = 0;
+static bool PGrnWRMRedoing = false;
+static void (*PGrnWRMPreviousXLogRedo)(XLogReaderState *record) = NULL;
+
+static void
+pgrnwrm_flush(const char *reason)
+{
+	grn_obj *db = grn_ctx_db(ctx);
+
+	GRN_LOG(ctx, GRN_LOG_DEBUG, PGRN_TAG ": flush: <%s>", reason);
+	if (db)
+		grn_obj_flush_only_opened(ctx, db);
+	PGrnWRMFlushDeferred = false;
+	PGrnWRMLastFlushTime = GetCurrentTimestamp();
+}
+
+/*
+ * Whether redo will wait for new WAL after this record. A small
+ * record such as a commit record may follow this record.
+ */
+static bool
+pgrnwrm_is_last_available_record(XLogReaderState *record)
+{
+	XLogRecPtr receivedLSN = GetWalRcvFlushRecPtr(NULL, NULL);
+
+	/* We can't know available WAL without WAL receiver. */
+	if (XLogRecPtrIsInvalid(receivedLSN))
+		return true;
+	if (receivedLSN <= record->EndRecPtr)
+		return true;
+	return receivedLSN - record->EndRecPtr < XLOG_BLCKSZ;
+}
+
+static void
+pgrnwrm_flush_deferred(XLogReaderState *record)
+{
+	PGrnWRMFlushDeferred = true;
+
+	if (PGrnWRMFlushInterval == 0)
+	{
+		pgrnwrm_flush("record");
+		return;
+	}
+
+	if (pgrnwrm_is_last_available_record(record))
+	{
+		pgrnwrm_flush("idle");
+		return;
+	}
+
+	if (TimestampDifferenceExceeds(
+			PGrnWRMLastFlushTime, GetCurrentTimestamp(), PGrnWRMFlushInterval))
+	{
+		pgrnwrm_flush("interval");
+		return;
+	}
+}
+
 typedef struct PGrnWRMRedoData
 {
 	PGrnWALRecordCommon *walRecord;
@@ -62,7 +155,11 @@ pgrnwrm_redo_setup(PGrnWRMRedoData *data, const char *tag)
 	pfree(databasePath);
 	db = grn_ctx_db(ctx);
 	if (db)
+	{
+		if (PGrnWRMFlushDeferred)
+			pgrnwrm_flush("database");
 		grn_obj_close(ctx, db);
+	}
 	if (pgrn_file_exist(path))
 	{
 		data->db = grn_db_open(ctx, path);
@@ -598,7 +695,7 @@ pgrnwrm_redo_insert(XLogReaderState *record)
 		insertData.tuple = &(walRecord.tuple);
 		pgrnwrm_redo_insert_tuple(&insertData);
 		grn_db_touch(ctx, grn_ctx_db(ctx));
-		grn_obj_flush_only_opened(ctx, grn_ctx_db(ctx));
+		pgrnwrm_flush_deferred(record);
 	}
 	PG_FINALLY();
 	{
@@ -671,7 +768,7 @@ pgrnwrm_redo_delete(XLogReaderState *record)
 				  tag,
 				  PGrnInspectKey(table, walRecord.key, walRecord.keySize));
 		grn_db_touch(ctx, grn_ctx_db(ctx));
-		grn_obj_flush_only_opened(ctx, grn_ctx_db(ctx));
+		pgrnwrm_flush_deferred(record);
 	}
 	PG_FINALLY();
 	{
@@ -828,7 +925,7 @@ pgrnwrm_redo_bulk_insert(XLogReaderState *record)
 			pgrnwrm_column_vector_values_clear(ctx, columnVectorValues);
 		}
 		grn_db_touch(ctx, grn_ctx_db(ctx));
-		grn_obj_flush_only_opened(ctx, grn_ctx_db(ctx));
+		pgrnwrm_flush_deferred(record);
 	}
 	PG_FINALLY();
 	{
@@ -842,6 +939,103 @@ pgrnwrm_redo_bulk_insert(XLogReaderState *record)
 	PG_END_TRY();
 }
 
+static void
+pgrnwrm_redo_bulk_delete(XLogReaderState *record)
+{
+	const char *tag = "[redo][bulk-delete]";
+	PGrnWALRecordRaw raw = {
+		.data = XLogRecGetData(record),
+		.size = XLogRecGetDataLen(record),
+	};
+	PGrnWALRecordBulkDelete walRecord = {0};
+	PGrnWRMRedoData data = {
+		.walRecord = (PGrnWALRecordCommon *) &walRecord,
+		.db = NULL,
+	};
+	PG_TRY();
+	{
+		grn_obj *table;
+		uint32 i;
+
+		PGrnWALRecordBulkDeleteRead(&walRecord, &raw);
+
+		pgrnwrm_redo_setup(&data, tag);
+		table = PGrnLookupWithSize(
+			walRecord.tableName, walRecord.tableNameSize, ERROR);
+		GRN_LOG(ctx,
+				GRN_LOG_DEBUG,
+				PGRN_TAG ": %s %X/%08X %u(%s)/%u table=<%.*s> n-keys=<%u>",
+				tag,
+				LSN_FORMAT_ARGS(record->ReadRecPtr),
+				walRecord.dbID,
+				pg_encoding_to_char(walRecord.dbEncoding),
+				walRecord.dbTableSpaceID,
+				(int) (walRecord.tableNameSize),
+				walRecord.tableName,
+				walRecord.nKeys);
+		if (table->header.type == GRN_TABLE_NO_KEY)
+		{
+			grn_obj *ctidColumn =
+				grn_obj_column(ctx, table, "ctid", strlen("ctid"));
+			grn_obj ctidValue;
+			grn_hash *packedCtids = grn_hash_create(
+				ctx, NULL, sizeof(uint64_t), 0, GRN_TABLE_HASH_KEY);
+			PGrnCheck("%s failed to create a packed ctids buffer", tag);
+			for (i = 0; i < walRecord.nKeys; i++)
+			{
+				grn_hash_add(ctx,
+							 packedCtids,
+							 &(walRecord.keys[i]),
+							 sizeof(uint64_t),
+							 NULL,
+							 NULL);
+			}
+			GRN_UINT64_INIT(&ctidValue, 0);
+			GRN_TABLE_EACH_BEGIN(ctx, table, cursor, id)
+			{
+				uint64_t packedCtid;
+
+				GRN_BULK_REWIND(&ctidValue);
+				grn_obj_get_value(ctx, ctidColumn, id, &ctidValue);
+				if (GRN_BULK_VSIZE(&ctidValue) == 0)
+					continue;
+				packedCtid = GRN_UINT64_VALUE(&ctidValue);
+				if (grn_hash_get(ctx,
+								 packedCtids,
+								 &packedCtid,
+								 sizeof(uint64_t),
+								 NULL) != GRN_ID_NIL)
+				{
+					grn_table_cursor_delete(ctx, cursor);
+				}
+			}
+			GRN_TABLE_EACH_END(ctx, cursor);
+			GRN_OBJ_FIN(ctx, &ctidValue);
+			grn_hash_close(ctx, packedCtids);
+		}
+		else
+		{
+			for (i = 0; i < walRecord.nKeys; i++)
+			{
+				grn_table_delete(
+					ctx, table, &(walRecord.keys[i]), sizeof(uint64_t));
+			}
+		}
+		PGrnCheck("%s failed to delete records: <%.*s>: <%u>",
+				  tag,
+				  (int) (walRecord.tableNameSize),
+				  walRecord.tableName,
+				  walRecord.nKeys);
+		grn_db_touch(ctx, grn_ctx_db(ctx));
+		pgrnwrm_flush_deferred(record);
+	}
+	PG_FINALLY();
+	{
+		pgrnwrm_redo_teardown(&data);
+	}
+	PG_END_TRY();
+}
+
 static const char *
 pgrnwrm_info_to_string(uint8 info)
 {
@@ -865,6 +1059,8 @@ pgrnwrm_info_to_string(uint8 info)
 		return "REGISTER_PLUGIN";
 	case PGRN_WAL_RECORD_BULK_INSERT:
 		return "BULK_INSERT";
+	case PGRN_WAL_RECORD_BULK_DELETE:
+		return "BULK_DELETE";
 	default:
 		return "UNKNOWN";
 	}
@@ -878,6 +1074,9 @@ pgrnwrm_redo(XLogReaderState *record)
 	if (!StandbyMode)
 		return;
 
+	/* This isn't reset on error. The startup process exits on
+	 * error. */
+	PGrnWRMRedoing = true;
 	info = XLogRecGetInfo(record) & XLR_RMGR_INFO_MASK;
 	GRN_LOG(ctx,
 			GRN_LOG_DEBUG,
@@ -914,12 +1113,16 @@ pgrnwrm_redo(XLogReaderState *record)
 	case PGRN_WAL_RECORD_BULK_INSERT:
 		pgrnwrm_redo_bulk_insert(record);
 		break;
+	case PGRN_WAL_RECORD_BULK_DELETE:
+		pgrnwrm_redo_bulk_delete(record);
+		break;
 	default:
 		ereport(ERROR,
 				errcode(ERRCODE_DATA_EXCEPTION),
 				errmsg(PGRN_TAG ": [redo] unknown info %u", info));
 		break;
 	}
+	PGrnWRMRedoing = false;
 }
 
 static void
@@ -962,6 +1165,9 @@ pgrnwrm_desc(StringInfo buffer, XLogReaderState *record)
 	case PGRN_WAL_RECORD_BULK_INSERT:
 		appendStringInfo(buffer, " action: bulk-insert");
 		break;
+	case PGRN_WAL_RECORD_BULK_DELETE:
+		appendStringInfo(buffer, " action: bulk-delete");
+		break;
 	default:
 		appendStringInfo(buffer, " action: unknown(%u)", info);
 		break;
@@ -976,6 +1182,43 @@ pgrnwrm_identify(uint8 info)
 	return pgrnwrm_info_to_string(info);
 }
 
+/*
+ * This is used as the redo of the built-in XLOG resource manager
+ * that replays checkpoint records. Deferred changes must be flushed
+ * before a checkpoint record is replayed because a restartpoint for
+ * the checkpoint may be finished before the next PGroonga WAL
+ * record.
+ */
+static void
+pgrnwrm_xlog_redo(XLogReaderState *record)
+{
+	if (PGrnWRMFlushDeferred)
+	{
+		uint8 info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+		if (info == XLOG_CHECKPOINT_SHUTDOWN ||
+			info == XLOG_CHECKPOINT_ONLINE)
+			pgrnwrm_flush("checkpoint");
+	}
+
+	PGrnWRMPreviousXLogRedo(record);
+}
+
+/*
+ * The startup process exits without rm_cleanup on shutdown. The
+ * shutdown restartpoint is created after the startup process exits.
+ */
+static void
+pgrnwrm_before_shmem_exit(int code, Datum arg)
+{
+	if (!PGrnWRMFlushDeferred)
+		return;
+	/* We may be in the middle of redo on error. */
+	if (PGrnWRMRedoing)
+		return;
+
+	pgrnwrm_flush("exit");
+}
+
 static void
 pgrnwrm_startup(void)
 {
@@ -1015,6 +1258,9 @@ pgrnwrm_startup(void)
 
 	GRN_LOG(ctx, GRN_LOG_NOTICE, PGRN_TAG ": startup: <%s>", PGRN_VERSION);
 
+	PGrnWRMLastFlushTime = GetCurrentTimestamp();
+	before_shmem_exit(pgrnwrm_before_shmem_exit, 0);
+
 	GRN_TEXT_INIT(&PGrnInspectBuffer, 0);
 }
 
@@ -1030,7 +1276,11 @@ pgrnwrm_cleanup(void)
 	GRN_OBJ_FIN(ctx, &PGrnInspectBuffer);
 	db = grn_ctx_db(ctx);
 	if (db)
+	{
+		if (PGrnWRMFlushDeferred)
+			pgrnwrm_flush("cleanup");
 		grn_obj_close(ctx, db);
+	}
 	grn_ctx_fin(ctx);
 	grn_fin();
 }
@@ -1078,7 +1328,32 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomIntVariable("pgroonga_wal_resource_manager.flush_interval",
+							"Interval to flush Groonga objects in redo in "
+							"milliseconds.",
+							"Redo for insert and delete defers flushing "
+							"Groonga objects by this interval. Deferred "
+							"changes are also flushed before a "
+							"checkpoint record is replayed and before "
+							"redo waits for new WAL. So a restartpoint "
+							"never covers deferred changes and they are "
+							"replayed again after OS crash. "
+							"The default is 0. "
+							"It means that Groonga objects are flushed "
+							"after each WAL record.",
+							&PGrnWRMFlushInterval,
+							PGrnWRMFlushInterval,
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							GUC_UNIT_MS,
+							NULL,
+							NULL,
+							NULL);
+
 #ifdef PGRN_SUPPORT_WAL_RESOURCE_MANAGER
 	RegisterCustomRmgr(PGRN_WAL_RESOURCE_MANAGER_ID, &data);
+	PGrnWRMPreviousXLogRedo = RmgrTable[RM_XLOG_ID].rm_redo;
+	RmgrTable[RM_XLOG_ID].rm_redo = pgrnwrm_xlog_redo;
 #endif
 }
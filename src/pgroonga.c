@@ -16,6 +16,7 @@
 #include "pgrn-groonga-tuple-is-alive.h"
 #include "pgrn-groonga.h"
 #include "pgrn-highlight-html.h"
+#include "pgrn-index-cache.h"
 #include "pgrn-index-status.h"
 #include "pgrn-jsonb.h"
 #include "pgrn-keywords.h"
@@ -53,9 +54,14 @@
 #include <mb/pg_wchar.h>
 #include <miscadmin.h>
 #include <nodes/nodeFuncs.h>
+#include <optimizer/cost.h>
 #include <optimizer/optimizer.h>
 #include <pgstat.h>
+#include <port/atomics.h>
+#include <portability/instr_time.h>
 #include <storage/bufmgr.h>
+#include <storage/condition_variable.h>
+#include <storage/dsm.h>
 #include <storage/ipc.h>
 #include <storage/latch.h>
 #include <storage/shm_toc.h>
@@ -68,6 +74,7 @@
 #include <utils/rel.h>
 #include <utils/selfuncs.h>
 #include <utils/snapmgr.h>
+#include <utils/spccache.h>
 #include <utils/timestamp.h>
 #include <utils/typcache.h>
 
@@ -93,20 +100,49 @@ static bool PGrnInitialized = false;
 static bool PGrnBaseInitialized = false;
 bool PGrnGroongaInitialized = false;
 static bool PGrnCrashSaferInitialized = false;
-bool PGrnEnableParallelBuildCopy = false;
+bool PGrnEnableParallelBuildCopy = true;
+int PGrnBuildThreads = 0;
+double PGrnPostingCost = DEFAULT_CPU_OPERATOR_COST;
+double PGrnDefaultSelectivity = 0.01;
+
+/* The number of recently removed Groonga objects that are shared
+ * with all processes. If a process misses more removed objects than
+ * this, the process unmaps the whole DB. They aren't shared when
+ * PGroonga isn't loaded by shared_preload_libraries. */
+#define PGRN_REMOVED_OBJECTS_SIZE 1024
+
+typedef struct PGrnRemovedObject
+{
+	Oid databaseID;
+	grn_id id;
+} PGrnRemovedObject;
 
 typedef struct PGrnProcessSharedData
 {
-	TimestampTz lastVacuumTimestamp;
+	slock_t mutex;
+	/* This is incremented for each removed object. This is used as
+	 * the generation of removed objects. */
+	uint64 nRemovedObjects;
+	uint32 removedObjectsSize;
+	PGrnRemovedObject removedObjects[FLEXIBLE_ARRAY_MEMBER];
 } PGrnProcessSharedData;
 
 typedef struct PGrnProcessLocalData
 {
-	TimestampTz lastDBUnmapTimestamp;
+	uint64 nRemovedObjects;
 } PGrnProcessLocalData;
 
 static PGrnProcessSharedData *processSharedData = NULL;
 static PGrnProcessLocalData processLocalData;
+/* Whether PGroonga is loaded by shared_preload_libraries. Shared
+ * memory is allocated from the spare shared memory otherwise. So we
+ * allocate only small shared data in the case. */
+static bool PGrnSharedMemoryRequested = false;
+
+#if PG_VERSION_NUM >= 150000
+static shmem_request_hook_type PreviousShmemRequestHook = NULL;
+#endif
+static shmem_startup_hook_type PreviousShmemStartupHook = NULL;
 
 typedef struct PGrnBuildStateData
 {
@@ -120,6 +156,7 @@ typedef struct PGrnBuildStateData
 	PGrnWALData *bulkInsertWALData;
 	bool isBulkInsert;
 	grn_wal_role walRoleKeep;
+	grn_hash *referenceCache;
 } PGrnBuildStateData;
 
 typedef PGrnBuildStateData *PGrnBuildState;
@@ -160,6 +197,8 @@ typedef struct PGrnScanOpaqueData
 	dlist_node node;
 	slist_head primaryKeyColumns;
 	grn_obj *scoreTargetRecords;
+
+	dsm_segment *parallelSegment;
 } PGrnScanOpaqueData;
 
 typedef PGrnScanOpaqueData *PGrnScanOpaque;
@@ -171,14 +210,52 @@ typedef struct PGrnPrefixRKSequentialSearchData
 	grn_obj *resultTable;
 } PGrnPrefixRKSequentialSearchData;
 
+/*
+ * The number of records that a parallel scan participant claims at
+ * once from the shared search result.
+ */
+#define PGRN_PARALLEL_SCAN_CHUNK_SIZE 1024
+
+typedef struct PGrnParallelScanRecord
+{
+	grn_id id;
+	double score;
+} PGrnParallelScanRecord;
+
+/*
+ * This is placed at the head of the DSM segment for the published
+ * result. The searcher may finish its scan and destroy the segment
+ * before other participants attach it. The handle of the destroyed
+ * segment may be reused by another segment. id is used to detect it.
+ */
+typedef struct PGrnParallelScanRecordsHeader
+{
+	uint64 id;
+} PGrnParallelScanRecordsHeader;
+
+#define PGRN_PARALLEL_SCAN_RECORDS_OFFSET                                      \
+	MAXALIGN(sizeof(PGrnParallelScanRecordsHeader))
+
 typedef struct PGrnParallelScanDescData
 {
 	slock_t mutex;
+	/* For range search. Only one participant scans. */
 	bool scanning;
+	/* For search. The first participant searches and publishes the
+	 * result as an array of PGrnParallelScanRecord in a DSM segment.
+	 * All participants claim records from the array by chunk. */
+	bool searching;
+	bool published;
+	dsm_handle recordsHandle;
+	uint64 recordsID;
+	uint64 nRecords;
+	pg_atomic_uint64 nextPosition;
+	ConditionVariable conditionVariable;
 } PGrnParallelScanDescData;
 typedef PGrnParallelScanDescData *PGrnParallelScanDesc;
 
 static bool PGrnParallelScanAcquire(IndexScanDesc scan);
+static uint32 PGrnParallelScanNPublished = 0;
 
 static dlist_head PGrnScanOpaques = DLIST_STATIC_INIT(PGrnScanOpaques);
 static unsigned int PGrnNScanOpaques = 0;
@@ -433,6 +510,9 @@ PGrnBeforeShmemExit(int code, Datum arg)
 			GRN_LOG(ctx, GRN_LOG_DEBUG, "%s[finalize][auto-close]", tag);
 			PGrnFinalizeAutoClose();
 
+			GRN_LOG(ctx, GRN_LOG_DEBUG, "%s[finalize][index-cache]", tag);
+			PGrnFinalizeIndexCache();
+
 			GRN_LOG(ctx,
 					GRN_LOG_DEBUG,
 					"%s[finalize][language-model-vectorize]",
@@ -586,6 +666,8 @@ PGrnInitializeDatabase(void)
 	PGrnInitializeLanguageModelVectorize();
 
 	PGrnInitializeAutoClose();
+
+	PGrnInitializeIndexCache();
 }
 
 void
@@ -688,6 +770,68 @@ PGrnEnsureDatabase(void)
 	PGrnInitializeDatabase();
 }
 
+static Size
+PGrnProcessSharedDataSize(void)
+{
+	Size size = offsetof(PGrnProcessSharedData, removedObjects);
+	if (PGrnSharedMemoryRequested)
+		size = add_size(
+			size,
+			mul_size(sizeof(PGrnRemovedObject), PGRN_REMOVED_OBJECTS_SIZE));
+	return size;
+}
+
+static Size
+PGrnSharedMemorySize(void)
+{
+	Size size = PGrnProcessSharedDataSize();
+	size = add_size(size, PGrnWALSharedMemorySize());
+	return size;
+}
+
+#if PG_VERSION_NUM >= 150000
+static void
+PGrnShmemRequest(void)
+{
+	if (PreviousShmemRequestHook)
+		PreviousShmemRequestHook();
+
+	RequestAddinShmemSpace(PGrnSharedMemorySize());
+}
+#endif
+
+static void
+PGrnInitializeSharedMemory(void)
+{
+	bool found;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	processSharedData = (PGrnProcessSharedData *) ShmemInitStruct(
+		"PGrnProcessSharedData", PGrnProcessSharedDataSize(), &found);
+	if (!found)
+	{
+		SpinLockInit(&(processSharedData->mutex));
+		processSharedData->nRemovedObjects = 0;
+		processSharedData->removedObjectsSize =
+			PGrnSharedMemoryRequested ? PGRN_REMOVED_OBJECTS_SIZE : 0;
+	}
+	LWLockRelease(AddinShmemInitLock);
+
+	/* WAL group commit and WAL apply statuses aren't available when
+	 * they can't be requested. */
+	if (PGrnSharedMemoryRequested)
+		PGrnInitializeWAL();
+}
+
+static void
+PGrnShmemStartup(void)
+{
+	if (PreviousShmemStartupHook)
+		PreviousShmemStartupHook();
+
+	PGrnInitializeSharedMemory();
+}
+
 void
 _PG_init(void)
 {
@@ -712,19 +856,34 @@ _PG_init(void)
 		grn_set_segv_handler();
 		grn_set_abrt_handler();
 
+		/* We can request shared memory only when we're loaded by
+		 * shared_preload_libraries. Shared memory is allocated from
+		 * the spare shared memory otherwise. */
+		if (process_shared_preload_libraries_in_progress)
+		{
+			PGrnSharedMemoryRequested = true;
+#if PG_VERSION_NUM >= 150000
+			PreviousShmemRequestHook = shmem_request_hook;
+			shmem_request_hook = PGrnShmemRequest;
+#else
+			RequestAddinShmemSpace(PGrnSharedMemorySize());
+#endif
+			PreviousShmemStartupHook = shmem_startup_hook;
+			shmem_startup_hook = PGrnShmemStartup;
+		}
+
 		if (IsUnderPostmaster)
 		{
-			bool found;
-			LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
-			processSharedData = (PGrnProcessSharedData *) ShmemInitStruct(
-				"PGrnProcessSharedData", sizeof(PGrnProcessSharedData), &found);
-			if (!found)
-			{
-				processSharedData->lastVacuumTimestamp = GetCurrentTimestamp();
-			}
-			LWLockRelease(AddinShmemInitLock);
+			PGrnInitializeSharedMemory();
+			SpinLockAcquire(&(processSharedData->mutex));
+			processLocalData.nRemovedObjects =
+				processSharedData->nRemovedObjects;
+			SpinLockRelease(&(processSharedData->mutex));
+		}
+		else
+		{
+			processLocalData.nRemovedObjects = 0;
 		}
-		processLocalData.lastDBUnmapTimestamp = GetCurrentTimestamp();
 
 		before_shmem_exit(PGrnBeforeShmemExit, 0);
 
@@ -774,6 +933,7 @@ PGrnUnmapDB(void)
 
 	PGrnFinalizeSequentialSearch();
 	PGrnFinalizeHighlightHTML();
+	PGrnIndexCacheInvalidate();
 
 	grn_db_unmap(ctx, grn_ctx_db(ctx));
 
@@ -783,10 +943,115 @@ PGrnUnmapDB(void)
 	PGRN_TRACE_LOG_EXIT();
 }
 
+static uint64
+PGrnGetNRemovedObjects(void)
+{
+	uint64 nRemovedObjects;
+
+	SpinLockAcquire(&(processSharedData->mutex));
+	nRemovedObjects = processSharedData->nRemovedObjects;
+	SpinLockRelease(&(processSharedData->mutex));
+
+	return nRemovedObjects;
+}
+
+/*
+ * Shares IDs of removed Groonga objects with all processes. Other
+ * processes close them in PGrnEnsureLatestDB().
+ */
+static void
+PGrnPublishRemovedObjects(grn_obj *ids)
+{
+	size_t i;
+	size_t nIDs;
+
+	if (!processSharedData)
+		return;
+
+	nIDs = GRN_BULK_VSIZE(ids) / sizeof(grn_id);
+	SpinLockAcquire(&(processSharedData->mutex));
+	if (processSharedData->removedObjectsSize == 0)
+	{
+		/* Other processes unmap the whole DB. */
+		processSharedData->nRemovedObjects += nIDs;
+	}
+	else
+	{
+		for (i = 0; i < nIDs; i++)
+		{
+			uint64 position = processSharedData->nRemovedObjects %
+							  processSharedData->removedObjectsSize;
+			PGrnRemovedObject *object =
+				&(processSharedData->removedObjects[position]);
+			object->databaseID = MyDatabaseId;
+			object->id = GRN_RECORD_VALUE_AT(ids, i);
+			processSharedData->nRemovedObjects++;
+		}
+	}
+	SpinLockRelease(&(processSharedData->mutex));
+}
+
+/*
+ * Closes Groonga objects removed by other processes since
+ * processLocalData.nRemovedObjects. Returns false when some removed
+ * objects were overwritten by newer removed objects.
+ */
+static bool
+PGrnCloseRemovedObjects(uint64 nRemovedObjects)
+{
+	uint64 nTargets = nRemovedObjects - processLocalData.nRemovedObjects;
+	uint32 size = processSharedData->removedObjectsSize;
+	PGrnRemovedObject *targets;
+	uint64 i;
+
+	if (nTargets > size)
+		return false;
+
+	targets = palloc(sizeof(PGrnRemovedObject) * nTargets);
+	for (i = 0; i < nTargets; i++)
+	{
+		uint64 position = (processLocalData.nRemovedObjects + i) % size;
+		targets[i] = processSharedData->removedObjects[position];
+	}
+	/* Removed objects may be overwritten while we copy them. */
+	if (PGrnGetNRemovedObjects() - processLocalData.nRemovedObjects > size)
+	{
+		pfree(targets);
+		return false;
+	}
+
+	PGrnFinalizeSequentialSearch();
+	PGrnFinalizeHighlightHTML();
+	PGrnIndexCacheInvalidate();
+	for (i = 0; i < nTargets; i++)
+	{
+		grn_id id = targets[i].id;
+		grn_obj *object;
+
+		if (targets[i].databaseID != MyDatabaseId)
+			continue;
+		if (!grn_ctx_is_opened(ctx, id))
+			continue;
+
+		object = grn_ctx_at(ctx, id);
+		GRN_LOG(ctx,
+				GRN_LOG_DEBUG,
+				"pgroonga: close removed object: <%s>",
+				PGrnInspectName(object));
+		grn_obj_close(ctx, object);
+	}
+	PGrnInitializeSequentialSearch();
+	PGrnInitializeHighlightHTML();
+
+	pfree(targets);
+	return true;
+}
+
 /* We need to close opened grn_objs after VACUUM. Because VACUUM may
  * remove opened but unused grn_objs. If we use a removed grn_obj, the
- * process will be crashed. This closes opened grn_objs only after
- * VACUUM.
+ * process will be crashed. This closes only removed grn_objs after
+ * VACUUM. If this process missed too many removed grn_objs, this
+ * unmaps the whole DB instead.
  *
  * This should not be called in the following functions:
  *
@@ -809,6 +1074,8 @@ PGrnUnmapDB(void)
 static bool
 PGrnEnsureLatestDB(void)
 {
+	uint64 nRemovedObjects;
+
 	PGRN_TRACE_LOG_ENTER();
 
 	if (!processSharedData)
@@ -817,17 +1084,22 @@ PGrnEnsureLatestDB(void)
 		return false;
 	}
 
-	if (processLocalData.lastDBUnmapTimestamp >
-		processSharedData->lastVacuumTimestamp)
+	nRemovedObjects = PGrnGetNRemovedObjects();
+	if (processLocalData.nRemovedObjects == nRemovedObjects)
 	{
 		PGRN_TRACE_LOG_EXIT();
 		return false;
 	}
 
-	GRN_LOG(
-		ctx, GRN_LOG_DEBUG, "pgroonga: unmap DB because VACUUM was executed");
-	PGrnUnmapDB();
-	processLocalData.lastDBUnmapTimestamp = GetCurrentTimestamp();
+	if (!PGrnCloseRemovedObjects(nRemovedObjects))
+	{
+		GRN_LOG(ctx,
+				GRN_LOG_DEBUG,
+				"pgroonga: unmap DB because too many objects were removed "
+				"by VACUUM");
+		PGrnUnmapDB();
+	}
+	processLocalData.nRemovedObjects = nRemovedObjects;
 
 	PGRN_TRACE_LOG_EXIT();
 	return true;
@@ -4889,9 +5161,84 @@ PGrnComputeSize(grn_obj *buffer)
 	}
 }
 
+/*
+ * Casting a text to a reference adds a record to the referenced
+ * table. grn_table_add() locks the table even when the record
+ * already exists. It's a bottleneck of parallel index build because
+ * all workers add the same keys to the same lexicon. This caches
+ * resolved record IDs in a process local hash to avoid it.
+ */
+#define PGRN_REFERENCE_CACHE_MAX_SIZE (1024 * 1024)
+
+static grn_rc
+PGrnCastWithReferenceCache(grn_hash *referenceCache,
+						   grn_obj *source,
+						   grn_obj *destination)
+{
+	grn_obj *table;
+	char cacheKey[GRN_TABLE_MAX_KEY_SIZE];
+	uint32_t cacheKeySize;
+	const char *key;
+	uint32_t keySize;
+	grn_id cacheID;
+	void *value;
+	int added = 0;
+	grn_id id;
+
+	if (!referenceCache)
+		return grn_obj_cast(ctx, source, destination, true);
+	if (!grn_obj_is_text_family_bulk(ctx, source))
+		return grn_obj_cast(ctx, source, destination, true);
+	table = grn_ctx_at(ctx, destination->header.domain);
+	if (!grn_obj_is_table(ctx, table))
+		return grn_obj_cast(ctx, source, destination, true);
+	if (!grn_type_id_is_text_family(ctx, table->header.domain))
+		return grn_obj_cast(ctx, source, destination, true);
+
+	key = GRN_TEXT_VALUE(source);
+	keySize = GRN_TEXT_LEN(source);
+	cacheKeySize = sizeof(grn_id) + keySize;
+	if (keySize == 0 || cacheKeySize > sizeof(cacheKey))
+		return grn_obj_cast(ctx, source, destination, true);
+
+	if (grn_hash_size(ctx, referenceCache) >= PGRN_REFERENCE_CACHE_MAX_SIZE)
+		grn_hash_truncate(ctx, referenceCache);
+
+	memcpy(cacheKey, &(destination->header.domain), sizeof(grn_id));
+	memcpy(cacheKey + sizeof(grn_id), key, keySize);
+	cacheID = grn_hash_add(
+		ctx, referenceCache, cacheKey, cacheKeySize, &value, &added);
+	if (cacheID == GRN_ID_NIL)
+		return grn_obj_cast(ctx, source, destination, true);
+
+	if (added)
+	{
+		/* grn_table_get() doesn't lock the table. Other workers may
+		 * already add the key. */
+		id = grn_table_get(ctx, table, key, keySize);
+		if (id == GRN_ID_NIL)
+			id = grn_table_add(ctx, table, key, keySize, NULL);
+		if (id == GRN_ID_NIL)
+		{
+			grn_hash_delete_by_id(ctx, referenceCache, cacheID, NULL);
+			return grn_obj_cast(ctx, source, destination, true);
+		}
+		*((grn_id *) value) = id;
+	}
+	else
+	{
+		id = *((grn_id *) value);
+	}
+
+	GRN_RECORD_SET(ctx, destination, id);
+	return GRN_SUCCESS;
+}
+
 static uint32_t
 PGrnInsertColumn(Relation index,
 				 grn_obj *sourcesTable,
+				 PGrnIndexCacheData *cache,
+				 grn_hash *referenceCache,
 				 Datum *values,
 				 PGrnWALData *walData,
 				 unsigned int i,
@@ -4901,17 +5248,30 @@ PGrnInsertColumn(Relation index,
 	TupleDesc desc = RelationGetDescr(index);
 	Form_pg_attribute attribute = TupleDescAttr(desc, i);
 	NameData *name = &(attribute->attname);
-	grn_obj *dataColumn = PGrnLookupColumn(sourcesTable, name->data, ERROR);
+	grn_obj *dataColumn;
 	grn_obj *rawValue = &(buffers->general);
 	grn_obj *value;
 	grn_id rawDomain;
 	unsigned char flags;
 	grn_id domain;
 
-	rawDomain = PGrnGetType(index, i, &flags);
+	if (cache)
+	{
+		PGrnIndexCacheColumn *cacheColumn =
+			PGrnIndexCacheGetColumn(cache, index, i);
+		dataColumn = cacheColumn->column;
+		rawDomain = cacheColumn->rawDomain;
+		flags = cacheColumn->flags;
+		domain = cacheColumn->domain;
+	}
+	else
+	{
+		dataColumn = PGrnLookupColumn(sourcesTable, name->data, ERROR);
+		rawDomain = PGrnGetType(index, i, &flags);
+		domain = grn_obj_get_range(ctx, dataColumn);
+	}
 	grn_obj_reinit(ctx, rawValue, rawDomain, flags);
 	PGrnConvertFromData(values[i], attribute->atttypid, rawValue);
-	domain = grn_obj_get_range(ctx, dataColumn);
 	if (domain == rawDomain)
 	{
 		value = rawValue;
@@ -4940,7 +5300,8 @@ PGrnInsertColumn(Relation index,
 					&rawElement, GRN_OBJ_DO_SHALLOW_COPY, elementDomain);
 				GRN_TEXT_SET(ctx, &rawElement, elementValue, elementSize);
 				grn_obj_reinit(ctx, element, domain, 0);
-				rc = grn_obj_cast(ctx, &rawElement, element, true);
+				rc = PGrnCastWithReferenceCache(
+					referenceCache, &rawElement, element);
 				if (rc != GRN_SUCCESS)
 					break;
 				grn_vector_add_element_float(ctx,
@@ -4978,7 +5339,7 @@ PGrnInsertColumn(Relation index,
 		}
 		else
 		{
-			rc = grn_obj_cast(ctx, rawValue, value, true);
+			rc = PGrnCastWithReferenceCache(referenceCache, rawValue, value);
 		}
 		GRN_OBJ_FIN(ctx, &rawElement);
 
@@ -5014,6 +5375,8 @@ static uint32_t
 PGrnInsert(Relation index,
 		   grn_obj *sourcesTable,
 		   grn_obj *sourcesCtidColumn,
+		   PGrnIndexCacheData *cache,
+		   grn_hash *referenceCache,
 		   Datum *values,
 		   bool *isnull,
 		   ItemPointer ht_ctid,
@@ -5113,8 +5476,15 @@ PGrnInsert(Relation index,
 		{
 			if (isnull[i])
 				continue;
-			recordSize += PGrnInsertColumn(
-				index, sourcesTable, values, walData, i, id, tag);
+			recordSize += PGrnInsertColumn(index,
+											sourcesTable,
+											cache,
+											referenceCache,
+											values,
+											walData,
+											i,
+											id,
+											tag);
 		}
 
 		PGrnWALInsertFinish(walData);
@@ -5132,6 +5502,109 @@ PGrnInsert(Relation index,
 	return recordSize;
 }
 
+#ifdef PGRN_SUPPORT_AM_INSERT_CLEANUP
+/*
+ * Multi-row inserts such as COPY and INSERT ... SELECT call
+ * pgroonga_insert() for each row. Records are added to Groonga
+ * immediately but per-statement works such as writing WAL, updating
+ * the max record size and grn_db_touch() are buffered. They are
+ * flushed when the buffer is filled or in pgroonga_insertcleanup()
+ * at the end of the statement.
+ */
+#	define PGRN_INSERT_BUFFER_SIZE 10000
+
+typedef struct PGrnInsertBufferData
+{
+	bool isBulkInsert;
+	PGrnWALData *walData;
+	bool needMaxRecordSizeUpdate;
+	uint32_t maxRecordSize;
+	uint32_t nRecords;
+	MemoryContextCallback resetCallback;
+} PGrnInsertBufferData;
+
+typedef PGrnInsertBufferData *PGrnInsertBuffer;
+
+static void
+PGrnInsertBufferReset(void *arg)
+{
+	PGrnInsertBuffer buffer = arg;
+
+	/* This is called without pgroonga_insertcleanup() on error. */
+	if (!buffer->walData)
+		return;
+	if (!PGrnGroongaInitialized)
+		return;
+
+	PGrnWALAbort(buffer->walData);
+	buffer->walData = NULL;
+}
+
+static PGrnInsertBuffer
+PGrnInsertBufferGet(Relation index, IndexInfo *indexInfo)
+{
+	PGrnInsertBuffer buffer = indexInfo->ii_AmCache;
+
+	if (buffer)
+		return buffer;
+
+	buffer = MemoryContextAlloc(indexInfo->ii_Context, sizeof(*buffer));
+	buffer->isBulkInsert =
+		PGrnWALResourceManagerIsOnlyEnabled() && !PGrnIsJSONBIndex(index);
+	buffer->walData = NULL;
+	buffer->needMaxRecordSizeUpdate = PGrnNeedMaxRecordSizeUpdate(index);
+	buffer->maxRecordSize = 0;
+	buffer->nRecords = 0;
+	buffer->resetCallback.func = PGrnInsertBufferReset;
+	buffer->resetCallback.arg = buffer;
+	MemoryContextRegisterResetCallback(indexInfo->ii_Context,
+									   &(buffer->resetCallback));
+	indexInfo->ii_AmCache = buffer;
+
+	return buffer;
+}
+
+static void
+PGrnInsertBufferStart(PGrnInsertBuffer buffer,
+					  Relation index,
+					  IndexInfo *indexInfo,
+					  grn_obj *sourcesTable)
+{
+	MemoryContext oldMemoryContext;
+
+	if (!buffer->isBulkInsert)
+		return;
+	if (buffer->walData)
+		return;
+
+	oldMemoryContext = MemoryContextSwitchTo(indexInfo->ii_Context);
+	buffer->walData = PGrnWALStart(index);
+	MemoryContextSwitchTo(oldMemoryContext);
+	PGrnWALBulkInsertStart(buffer->walData, sourcesTable);
+}
+
+static void
+PGrnInsertBufferFlush(PGrnInsertBuffer buffer, Relation index)
+{
+	if (buffer->walData)
+	{
+		PGrnWALBulkInsertFinish(buffer->walData);
+		PGrnWALFinish(buffer->walData);
+		buffer->walData = NULL;
+	}
+
+	if (buffer->nRecords == 0)
+		return;
+
+	if (buffer->needMaxRecordSizeUpdate)
+		PGrnUpdateMaxRecordSize(index, buffer->maxRecordSize);
+	grn_db_touch(ctx, grn_ctx_db(ctx));
+
+	buffer->maxRecordSize = 0;
+	buffer->nRecords = 0;
+}
+#endif
+
 static bool
 pgroonga_insert(Relation index,
 				Datum *values,
@@ -5145,9 +5618,13 @@ pgroonga_insert(Relation index,
 				struct IndexInfo *indexInfo)
 {
 	const char *tag = "[insert]";
+	PGrnIndexCacheData *cache;
 	grn_obj *sourcesTable;
 	grn_obj *sourcesCtidColumn = NULL;
 	uint32_t recordSize;
+#ifdef PGRN_SUPPORT_AM_INSERT_CLEANUP
+	PGrnInsertBuffer buffer;
+#endif
 
 	PGRN_TRACE_LOG_ENTER();
 
@@ -5165,14 +5642,43 @@ pgroonga_insert(Relation index,
 
 	PGrnWALApply(index);
 
-	sourcesTable = PGrnLookupSourcesTable(index, ERROR);
-	if (sourcesTable->header.type == GRN_TABLE_NO_KEY)
+	cache = PGrnIndexCacheGet(index);
+	if (cache)
+	{
+		sourcesTable = cache->sourcesTable;
+		sourcesCtidColumn = cache->sourcesCtidColumn;
+	}
+	else
 	{
-		sourcesCtidColumn = PGrnLookupSourcesCtidColumn(index, ERROR);
+		sourcesTable = PGrnLookupSourcesTable(index, ERROR);
+		if (sourcesTable->header.type == GRN_TABLE_NO_KEY)
+		{
+			sourcesCtidColumn = PGrnLookupSourcesCtidColumn(index, ERROR);
+		}
 	}
+#ifdef PGRN_SUPPORT_AM_INSERT_CLEANUP
+	buffer = PGrnInsertBufferGet(index, indexInfo);
+	PGrnInsertBufferStart(buffer, index, indexInfo, sourcesTable);
+	recordSize = PGrnInsert(index,
+							sourcesTable,
+							sourcesCtidColumn,
+							cache,
+							NULL,
+							values,
+							isnull,
+							ctid,
+							buffer->isBulkInsert,
+							buffer->walData);
+	buffer->maxRecordSize = Max(buffer->maxRecordSize, recordSize);
+	buffer->nRecords++;
+	if (buffer->nRecords >= PGRN_INSERT_BUFFER_SIZE)
+		PGrnInsertBufferFlush(buffer, index);
+#else
 	recordSize = PGrnInsert(index,
 							sourcesTable,
 							sourcesCtidColumn,
+							cache,
+							NULL,
 							values,
 							isnull,
 							ctid,
@@ -5181,12 +5687,28 @@ pgroonga_insert(Relation index,
 	if (PGrnNeedMaxRecordSizeUpdate(index))
 		PGrnUpdateMaxRecordSize(index, recordSize);
 	grn_db_touch(ctx, grn_ctx_db(ctx));
+#endif
 
 	PGRN_TRACE_LOG_EXIT();
 
 	return false;
 }
 
+#ifdef PGRN_SUPPORT_AM_INSERT_CLEANUP
+static void
+pgroonga_insertcleanup(Relation index, struct IndexInfo *indexInfo)
+{
+	PGrnInsertBuffer buffer = indexInfo->ii_AmCache;
+
+	PGRN_TRACE_LOG_ENTER();
+
+	if (buffer)
+		PGrnInsertBufferFlush(buffer, index);
+
+	PGRN_TRACE_LOG_EXIT();
+}
+#endif
+
 static void
 PGrnPrimaryKeyColumnsFin(slist_head *columns)
 {
@@ -5329,6 +5851,7 @@ PGrnScanOpaqueInit(PGrnScanOpaque so, Relation index)
 	PGrnNScanOpaques++;
 	PGrnScanOpaqueInitPrimaryKeyColumns(so);
 	so->scoreTargetRecords = NULL;
+	so->parallelSegment = NULL;
 
 	GRN_LOG(ctx,
 			GRN_LOG_DEBUG,
@@ -5384,6 +5907,11 @@ PGrnScanOpaqueReinit(PGrnScanOpaque so)
 		grn_obj_close(ctx, so->searched);
 		so->searched = NULL;
 	}
+	if (so->parallelSegment)
+	{
+		dsm_detach(so->parallelSegment);
+		so->parallelSegment = NULL;
+	}
 	GRN_BULK_REWIND(&(so->canReturns));
 
 	GRN_LOG(ctx,
@@ -6730,6 +7258,31 @@ PGrnSearchDataFree(PGrnSearchData *data)
 	GRN_OBJ_FIN(ctx, &(data->sectionID));
 }
 
+/*
+ * Index AMs can't add information to EXPLAIN. So statistics of Groonga
+ * are logged instead. Use pgroonga.log_level = debug to see them.
+ */
+static void
+PGrnSearchLogStatistics(PGrnScanOpaque so,
+						PGrnSearchData *data,
+						instr_time elapsedTime)
+{
+	const char *tag = "pgroonga: [search][statistics]";
+
+	if (!grn_logger_pass(ctx, GRN_LOG_DEBUG))
+		return;
+
+	GRN_LOG(ctx,
+			GRN_LOG_DEBUG,
+			"%s <%s>: estimated:<%u> hits:<%u> elapsed:<%.3f>ms: %s",
+			tag,
+			RelationGetRelationName(so->index),
+			grn_expr_estimate_size(ctx, data->expression),
+			grn_table_size(ctx, so->searched),
+			INSTR_TIME_GET_MILLISEC(elapsedTime),
+			PGrnInspect(data->expression));
+}
+
 static void
 PGrnSearch(IndexScanDesc scan)
 {
@@ -6739,6 +7292,12 @@ PGrnSearch(IndexScanDesc scan)
 	if (scan->numberOfKeys == 0)
 		return;
 
+#if PG_VERSION_NUM >= 180000
+	/* Shown as "Index Searches" by EXPLAIN ANALYZE. */
+	if (scan->instrument)
+		scan->instrument->nsearches++;
+#endif
+
 	PGrnSearchDataInit(&data, so->index, so->sourcesTable);
 	PG_TRY();
 	{
@@ -6764,10 +7323,17 @@ PGrnSearch(IndexScanDesc scan)
 	{
 		grn_table_selector *table_selector = grn_table_selector_open(
 			ctx, so->sourcesTable, data.expression, GRN_OP_OR);
+		instr_time startTime;
+		instr_time elapsedTime;
+
 		grn_table_selector_set_fuzzy_max_distance_ratio(
 			ctx, table_selector, data.fuzzyMaxDistanceRatio);
+		INSTR_TIME_SET_CURRENT(startTime);
 		grn_table_selector_select(ctx, table_selector, so->searched);
+		INSTR_TIME_SET_CURRENT(elapsedTime);
+		INSTR_TIME_SUBTRACT(elapsedTime, startTime);
 		grn_table_selector_close(ctx, table_selector);
+		PGrnSearchLogStatistics(so, &data, elapsedTime);
 	}
 	PGrnSearchDataFree(&data);
 }
@@ -6775,12 +7341,15 @@ PGrnSearch(IndexScanDesc scan)
 static void
 PGrnSort(IndexScanDesc scan)
 {
+	const char *tag = "pgroonga: [sort]";
 	PGrnScanOpaque so = (PGrnScanOpaque) scan->opaque;
 	ScanKey key;
 	TupleDesc desc;
 	Form_pg_attribute attribute;
 	const char *targetColumnName;
 	grn_table_sort_key sort_key;
+	instr_time startTime;
+	instr_time elapsedTime;
 
 	if (!so->searched)
 		return;
@@ -6803,8 +7372,17 @@ PGrnSort(IndexScanDesc scan)
 
 	sort_key.flags = GRN_TABLE_SORT_ASC;
 	sort_key.offset = 0;
+	INSTR_TIME_SET_CURRENT(startTime);
 	grn_table_sort(ctx, so->searched, 0, -1, so->sorted, &sort_key, 1);
+	INSTR_TIME_SET_CURRENT(elapsedTime);
+	INSTR_TIME_SUBTRACT(elapsedTime, startTime);
 	grn_obj_close(ctx, sort_key.key);
+	GRN_LOG(ctx,
+			GRN_LOG_DEBUG,
+			"%s <%s>: elapsed:<%.3f>ms",
+			tag,
+			RelationGetRelationName(so->index),
+			INSTR_TIME_GET_MILLISEC(elapsedTime));
 }
 
 static void
@@ -7121,19 +7699,333 @@ PGrnIsRangeSearchable(IndexScanDesc scan)
 	return true;
 }
 
+static PGrnParallelScanDesc
+PGrnParallelScanGetDesc(IndexScanDesc scan)
+{
+	ParallelIndexScanDesc parallelScan = scan->parallel_scan;
+	return OffsetToPointer((void *) (parallelScan),
+						   PGRN_PARALLEL_SCAN_GET_PS_OFFSET_AM(parallelScan));
+}
+
+static PGrnParallelScanRecord *
+PGrnParallelScanGetRecords(dsm_segment *segment)
+{
+	return (PGrnParallelScanRecord *) ((char *) dsm_segment_address(segment) +
+									   PGRN_PARALLEL_SCAN_RECORDS_OFFSET);
+}
+
 static void
-PGrnEnsureCursorOpened(IndexScanDesc scan, ScanDirection dir, bool needSort)
+PGrnParallelScanPublish(IndexScanDesc scan, PGrnParallelScanDesc desc)
 {
+	const char *tag = "pgroonga: [parallel-scan][publish]";
 	PGrnScanOpaque so = (PGrnScanOpaque) scan->opaque;
+	grn_obj *table;
+	uint64 nRecords;
+	dsm_handle handle = DSM_HANDLE_INVALID;
+	uint64 recordsID = 0;
 
-	scan->xs_recheck = false;
-
-	{
-		int i;
-		for (i = 0; i < scan->numberOfKeys; i++)
+	table = so->sorted;
+	if (!table)
+		table = so->searched;
+	if (!table)
+		table = so->sourcesTable;
+	nRecords = grn_table_size(ctx, table);
+
+	if (nRecords > 0)
+	{
+		PGrnParallelScanRecordsHeader *header;
+		PGrnParallelScanRecord *records;
+		grn_obj *scoreAccessor;
+		uint64 i = 0;
+
+		so->parallelSegment =
+			dsm_create(PGRN_PARALLEL_SCAN_RECORDS_OFFSET +
+						   sizeof(PGrnParallelScanRecord) * nRecords,
+					   0);
+		/* This must be alive until this scan is finished even when
+		 * this transaction is aborted. PGrnScanOpaqueReinit() detaches
+		 * this. */
+		dsm_pin_mapping(so->parallelSegment);
+		handle = dsm_segment_handle(so->parallelSegment);
+		/* Unique among live processes. */
+		recordsID =
+			((uint64) MyProcPid << 32) | (++PGrnParallelScanNPublished);
+		header = dsm_segment_address(so->parallelSegment);
+		header->id = recordsID;
+		records = PGrnParallelScanGetRecords(so->parallelSegment);
+
+		if (so->searched)
 		{
-			ScanKey key = &(scan->keyData[i]);
-			if (key->sk_strategy == PGrnLikeStrategyNumber ||
+			scoreAccessor = grn_obj_column(ctx,
+										   so->searched,
+										   GRN_COLUMN_NAME_SCORE,
+										   GRN_COLUMN_NAME_SCORE_LEN);
+		}
+		else
+		{
+			scoreAccessor = NULL;
+		}
+		GRN_TABLE_EACH_BEGIN(ctx, table, cursor, id)
+		{
+			grn_id searchedID = id;
+
+			if (!so->searched)
+			{
+				records[i].id = id;
+				records[i].score = 0.0;
+				i++;
+				continue;
+			}
+
+			if (so->sorted)
+			{
+				GRN_BULK_REWIND(&(buffers->general));
+				grn_obj_get_value(ctx, so->sorted, id, &(buffers->general));
+				searchedID = GRN_RECORD_VALUE(&(buffers->general));
+			}
+			grn_table_get_key(ctx,
+							  so->searched,
+							  searchedID,
+							  &(records[i].id),
+							  sizeof(grn_id));
+			GRN_BULK_REWIND(&(buffers->score));
+			grn_obj_get_value(
+				ctx, scoreAccessor, searchedID, &(buffers->score));
+			if (buffers->score.header.domain == GRN_DB_FLOAT)
+			{
+				records[i].score = GRN_FLOAT_VALUE(&(buffers->score));
+			}
+			else
+			{
+				records[i].score = GRN_INT32_VALUE(&(buffers->score));
+			}
+			i++;
+		}
+		GRN_TABLE_EACH_END(ctx, cursor);
+		if (scoreAccessor)
+			grn_obj_unlink(ctx, scoreAccessor);
+	}
+
+	/* Participants use chunks of the published result instead. */
+	if (so->sorted)
+	{
+		grn_obj_close(ctx, so->sorted);
+		so->sorted = NULL;
+	}
+	if (so->searched)
+	{
+		grn_obj_close(ctx, so->searched);
+		so->searched = NULL;
+	}
+
+	GRN_LOG(ctx,
+			GRN_LOG_DEBUG,
+			"%s <%s>(%u): <%" PRIu64 ">",
+			tag,
+			so->index->rd_rel->relname.data,
+			so->index->rd_id,
+			(uint64_t) nRecords);
+
+	SpinLockAcquire(&(desc->mutex));
+	desc->recordsHandle = handle;
+	desc->recordsID = recordsID;
+	desc->nRecords = nRecords;
+	desc->published = true;
+	SpinLockRelease(&(desc->mutex));
+	ConditionVariableBroadcast(&(desc->conditionVariable));
+}
+
+/*
+ * Fills so->searched with the next chunk of the published result.
+ * This returns false when all records are already claimed.
+ */
+static bool
+PGrnParallelScanClaim(IndexScanDesc scan)
+{
+	PGrnScanOpaque so = (PGrnScanOpaque) scan->opaque;
+	PGrnParallelScanDesc desc = PGrnParallelScanGetDesc(scan);
+	PGrnParallelScanRecord *records;
+	grn_obj *scoreAccessor;
+	grn_obj score;
+	uint64 start;
+	uint64 end;
+	uint64 i;
+
+	if (so->ctidResolveTable)
+	{
+		grn_obj_close(ctx, so->ctidResolveTable);
+		so->ctidResolveTable = NULL;
+	}
+	grn_table_truncate(ctx, so->searched);
+
+	if (!so->parallelSegment)
+		return false;
+
+	start = pg_atomic_fetch_add_u64(&(desc->nextPosition),
+									PGRN_PARALLEL_SCAN_CHUNK_SIZE);
+	if (start >= desc->nRecords)
+		return false;
+	end = Min(start + PGRN_PARALLEL_SCAN_CHUNK_SIZE, desc->nRecords);
+
+	records = PGrnParallelScanGetRecords(so->parallelSegment);
+	scoreAccessor = grn_obj_column(
+		ctx, so->searched, GRN_COLUMN_NAME_SCORE, GRN_COLUMN_NAME_SCORE_LEN);
+	GRN_FLOAT_INIT(&score, 0);
+	for (i = start; i < end; i++)
+	{
+		grn_id id;
+
+		id = grn_table_add(
+			ctx, so->searched, &(records[i].id), sizeof(grn_id), NULL);
+		if (id == GRN_ID_NIL)
+			continue;
+		GRN_FLOAT_SET(ctx, &score, records[i].score);
+		grn_obj_set_value(ctx, scoreAccessor, id, &score, GRN_OBJ_SET);
+	}
+	GRN_OBJ_FIN(ctx, &score);
+	grn_obj_unlink(ctx, scoreAccessor);
+
+	return true;
+}
+
+/*
+ * Opens a table cursor for the next chunk. This is used when the
+ * current table cursor is exhausted.
+ */
+static bool
+PGrnParallelScanClaimNext(IndexScanDesc scan, ScanDirection dir)
+{
+	const char *tag = "[parallel-scan][claim-next]";
+	PGrnScanOpaque so = (PGrnScanOpaque) scan->opaque;
+	int flags = 0;
+
+	if (!so->parallelSegment)
+		return false;
+
+	if (so->tableCursor)
+	{
+		grn_table_cursor_close(ctx, so->tableCursor);
+		so->tableCursor = NULL;
+	}
+
+	if (!PGrnParallelScanClaim(scan))
+		return false;
+
+	if (ScanDirectionIsBackward(dir))
+		flags |= GRN_CURSOR_DESCENDING;
+	else
+		flags |= GRN_CURSOR_ASCENDING;
+	so->tableCursor = grn_table_cursor_open(
+		ctx, so->searched, NULL, 0, NULL, 0, 0, -1, flags);
+	PGrnCheck("%s failed to open cursor", tag);
+
+	return true;
+}
+
+/*
+ * The first participant searches and publishes the result. Other
+ * participants wait for it. All participants claim chunks of the
+ * published result. So each participant's so->searched has only
+ * records in the claimed chunk.
+ */
+static void
+PGrnParallelScanOpenTableCursor(IndexScanDesc scan,
+								ScanDirection dir,
+								bool needSort)
+{
+	PGrnScanOpaque so = (PGrnScanOpaque) scan->opaque;
+	PGrnParallelScanDesc desc = PGrnParallelScanGetDesc(scan);
+	bool searcher = false;
+	dsm_handle handle;
+	uint64 recordsID;
+
+	SpinLockAcquire(&(desc->mutex));
+	if (!desc->searching)
+	{
+		desc->searching = true;
+		searcher = true;
+	}
+	SpinLockRelease(&(desc->mutex));
+
+	if (searcher)
+	{
+		PGrnSearch(scan);
+		if (needSort)
+			PGrnSort(scan);
+		PGrnParallelScanPublish(scan, desc);
+	}
+	else
+	{
+		ConditionVariablePrepareToSleep(&(desc->conditionVariable));
+		while (true)
+		{
+			bool published;
+
+			SpinLockAcquire(&(desc->mutex));
+			published = desc->published;
+			SpinLockRelease(&(desc->mutex));
+			if (published)
+				break;
+
+			ConditionVariableSleep(&(desc->conditionVariable),
+								   PG_WAIT_EXTENSION);
+		}
+		ConditionVariableCancelSleep();
+
+		SpinLockAcquire(&(desc->mutex));
+		handle = desc->recordsHandle;
+		recordsID = desc->recordsID;
+		SpinLockRelease(&(desc->mutex));
+		if (handle != DSM_HANDLE_INVALID)
+		{
+			/* The segment may be already destroyed or another segment
+			 * may use the handle when the searcher already finished its
+			 * scan. It means that all records were claimed. */
+			so->parallelSegment = dsm_attach(handle);
+			if (so->parallelSegment)
+			{
+				PGrnParallelScanRecordsHeader *header =
+					dsm_segment_address(so->parallelSegment);
+				if (dsm_segment_map_length(so->parallelSegment) <
+						PGRN_PARALLEL_SCAN_RECORDS_OFFSET ||
+					header->id != recordsID)
+				{
+					dsm_detach(so->parallelSegment);
+					so->parallelSegment = NULL;
+				}
+				else
+				{
+					dsm_pin_mapping(so->parallelSegment);
+				}
+			}
+		}
+	}
+
+	so->searched =
+		grn_table_create(ctx,
+						 NULL,
+						 0,
+						 NULL,
+						 GRN_OBJ_TABLE_HASH_KEY | GRN_OBJ_WITH_SUBREC,
+						 so->sourcesTable,
+						 0);
+	PGrnParallelScanClaim(scan);
+	PGrnOpenTableCursor(scan, dir);
+}
+
+static void
+PGrnEnsureCursorOpened(IndexScanDesc scan, ScanDirection dir, bool needSort)
+{
+	PGrnScanOpaque so = (PGrnScanOpaque) scan->opaque;
+
+	scan->xs_recheck = false;
+
+	{
+		int i;
+		for (i = 0; i < scan->numberOfKeys; i++)
+		{
+			ScanKey key = &(scan->keyData[i]);
+			if (key->sk_strategy == PGrnLikeStrategyNumber ||
 				key->sk_strategy == PGrnILikeStrategyNumber)
 			{
 				scan->xs_recheck = true;
@@ -7151,6 +8043,10 @@ PGrnEnsureCursorOpened(IndexScanDesc scan, ScanDirection dir, bool needSort)
 	{
 		PGrnRangeSearch(scan, dir);
 	}
+	else if (scan->parallel_scan)
+	{
+		PGrnParallelScanOpenTableCursor(scan, dir, needSort);
+	}
 	else
 	{
 		PGrnSearch(scan);
@@ -7329,6 +8225,9 @@ pgroonga_gettuple_internal(IndexScanDesc scan, ScanDirection direction)
 		else
 		{
 			so->currentID = grn_table_cursor_next(ctx, so->tableCursor);
+			if (so->currentID == GRN_ID_NIL && scan->parallel_scan &&
+				PGrnParallelScanClaimNext(scan, direction))
+				continue;
 		}
 
 		if (so->currentID == GRN_ID_NIL)
@@ -7423,12 +8322,136 @@ pgroonga_gettuple(IndexScanDesc scan, ScanDirection direction)
 	return found;
 }
 
+#define PGRN_GET_BITMAP_BATCH_SIZE 1024
+
+typedef struct PGrnGetBitmapBatchData
+{
+	TIDBitmap *tbm;
+	bool recheck;
+	grn_column_cache *sourcesCtidColumnCache;
+	uint64_t packedCtids[PGRN_GET_BITMAP_BATCH_SIZE];
+	ItemPointerData ctids[PGRN_GET_BITMAP_BATCH_SIZE];
+	size_t nPackedCtids;
+	int64 nRecords;
+} PGrnGetBitmapBatchData;
+
+static int
+PGrnPackedCtidCompare(const void *a, const void *b)
+{
+	const uint64_t packedCtidA = *((const uint64_t *) a);
+	const uint64_t packedCtidB = *((const uint64_t *) b);
+
+	if (packedCtidA < packedCtidB)
+		return -1;
+	if (packedCtidA > packedCtidB)
+		return 1;
+	return 0;
+}
+
+/*
+ * Packed ctid is "block number << 16 | offset number". So sorting
+ * packed ctids sorts them in heap order and we can pass all TIDs in
+ * the same heap page to tbm_add_tuples() at once.
+ */
+static void
+PGrnGetBitmapBatchFlush(PGrnGetBitmapBatchData *batch)
+{
+	size_t i;
+	int nCtids = 0;
+	BlockNumber currentBlock = InvalidBlockNumber;
+
+	if (batch->nPackedCtids == 0)
+		return;
+
+	qsort(batch->packedCtids,
+		  batch->nPackedCtids,
+		  sizeof(uint64_t),
+		  PGrnPackedCtidCompare);
+	for (i = 0; i < batch->nPackedCtids; i++)
+	{
+		ItemPointerData ctid = PGrnCtidUnpack(batch->packedCtids[i]);
+		BlockNumber block;
+
+		if (!ItemPointerIsValid(&ctid))
+			continue;
+
+		block = ItemPointerGetBlockNumber(&ctid);
+		if (nCtids > 0 && block != currentBlock)
+		{
+			tbm_add_tuples(batch->tbm, batch->ctids, nCtids, batch->recheck);
+			batch->nRecords += nCtids;
+			nCtids = 0;
+		}
+		currentBlock = block;
+		batch->ctids[nCtids++] = ctid;
+	}
+	if (nCtids > 0)
+	{
+		tbm_add_tuples(batch->tbm, batch->ctids, nCtids, batch->recheck);
+		batch->nRecords += nCtids;
+	}
+	batch->nPackedCtids = 0;
+}
+
+static void
+PGrnGetBitmapBatchAdd(PGrnGetBitmapBatchData *batch, uint64_t packedCtid)
+{
+	batch->packedCtids[batch->nPackedCtids++] = packedCtid;
+	if (batch->nPackedCtids == PGRN_GET_BITMAP_BATCH_SIZE)
+		PGrnGetBitmapBatchFlush(batch);
+}
+
+/*
+ * This reads ctid of the sourceID record in the sources table
+ * directly. This doesn't use so->ctidAccessor because an accessor
+ * needs to resolve the whole accessor chain for each record.
+ */
+static bool
+PGrnGetBitmapGetPackedCtid(PGrnScanOpaque so,
+						   PGrnGetBitmapBatchData *batch,
+						   grn_id sourceID,
+						   uint64_t *packedCtid)
+{
+	if (batch->sourcesCtidColumnCache)
+	{
+		void *value;
+		size_t valueSize;
+
+		value = grn_column_cache_ref(
+			ctx, batch->sourcesCtidColumnCache, sourceID, &valueSize);
+		if (valueSize != sizeof(uint64_t))
+			return false;
+		*packedCtid = *((uint64_t *) value);
+	}
+	else if (so->sourcesTable->header.type == GRN_TABLE_NO_KEY)
+	{
+		GRN_BULK_REWIND(&(buffers->ctid));
+		grn_obj_get_value(
+			ctx, so->sourcesCtidColumn, sourceID, &(buffers->ctid));
+		if (GRN_BULK_VSIZE(&(buffers->ctid)) != sizeof(uint64_t))
+			return false;
+		*packedCtid = GRN_UINT64_VALUE(&(buffers->ctid));
+	}
+	else
+	{
+		int keySize;
+
+		keySize = grn_table_get_key(
+			ctx, so->sourcesTable, sourceID, packedCtid, sizeof(uint64_t));
+		if (keySize != sizeof(uint64_t))
+			return false;
+	}
+
+	return true;
+}
+
 static int64
 pgroonga_getbitmap_internal(IndexScanDesc scan, TIDBitmap *tbm)
 {
 	const char *tag = "pgroonga: [get-bitmap]";
 	PGrnScanOpaque so = (PGrnScanOpaque) scan->opaque;
-	int64 nRecords = 0;
+	PGrnGetBitmapBatchData *batch;
+	int64 nRecords;
 
 	if (scan->parallel_scan)
 	{
@@ -7445,6 +8468,16 @@ pgroonga_getbitmap_internal(IndexScanDesc scan, TIDBitmap *tbm)
 
 	PGrnEnsureCursorOpened(scan, ForwardScanDirection, false);
 
+	batch = palloc(sizeof(PGrnGetBitmapBatchData));
+	batch->tbm = tbm;
+	batch->recheck = scan->xs_recheck;
+	batch->sourcesCtidColumnCache = NULL;
+	batch->nPackedCtids = 0;
+	batch->nRecords = 0;
+	if (so->sourcesCtidColumn)
+		batch->sourcesCtidColumnCache =
+			grn_column_cache_open(ctx, so->sourcesCtidColumn);
+
 	if (so->indexCursor)
 	{
 		grn_posting *posting;
@@ -7452,13 +8485,10 @@ pgroonga_getbitmap_internal(IndexScanDesc scan, TIDBitmap *tbm)
 		while ((posting = grn_index_cursor_next(ctx, so->indexCursor, &termID)))
 		{
 			uint64_t packedCtid;
-			ItemPointerData ctid;
 
 			so->currentID = posting->rid;
-			GRN_BULK_REWIND(&(buffers->ctid));
-			grn_obj_get_value(
-				ctx, so->ctidAccessor, so->currentID, &(buffers->ctid));
-			if (GRN_BULK_VSIZE(&(buffers->ctid)) == 0)
+			if (!PGrnGetBitmapGetPackedCtid(
+					so, batch, so->currentID, &packedCtid))
 			{
 				GRN_LOG(ctx,
 						GRN_LOG_DEBUG,
@@ -7470,24 +8500,7 @@ pgroonga_getbitmap_internal(IndexScanDesc scan, TIDBitmap *tbm)
 				continue;
 			}
 
-			packedCtid = GRN_UINT64_VALUE(&(buffers->ctid));
-			ctid = PGrnCtidUnpack(packedCtid);
-			GRN_LOG(ctx,
-					GRN_LOG_DEBUG,
-					"%s[index-cursor] <%s>(%u): <%u>: <(%u,%u),%u>(%" PRIu64
-					")",
-					tag,
-					so->index->rd_rel->relname.data,
-					so->index->rd_id,
-					so->currentID,
-					ctid.ip_blkid.bi_hi,
-					ctid.ip_blkid.bi_lo,
-					ctid.ip_posid,
-					packedCtid);
-			if (!ItemPointerIsValid(&ctid))
-				continue;
-			tbm_add_tuples(tbm, &ctid, 1, scan->xs_recheck);
-			nRecords++;
+			PGrnGetBitmapBatchAdd(batch, packedCtid);
 		}
 	}
 	else
@@ -7495,47 +8508,76 @@ pgroonga_getbitmap_internal(IndexScanDesc scan, TIDBitmap *tbm)
 		while (true)
 		{
 			uint64_t packedCtid;
-			ItemPointerData ctid;
 
 			so->currentID = grn_table_cursor_next(ctx, so->tableCursor);
 			if (so->currentID == GRN_ID_NIL)
+			{
+				if (scan->parallel_scan &&
+					PGrnParallelScanClaimNext(scan, ForwardScanDirection))
+					continue;
 				break;
+			}
 
-			GRN_BULK_REWIND(&(buffers->ctid));
-			grn_obj_get_value(
-				ctx, so->ctidAccessor, so->currentID, &(buffers->ctid));
-			if (GRN_BULK_VSIZE(&(buffers->ctid)) == 0)
+			if (so->sorted)
 			{
-				GRN_LOG(ctx,
-						GRN_LOG_DEBUG,
-						"%s[nonexistent] <%s>(%u): <%u>",
-						tag,
-						so->index->rd_rel->relname.data,
-						so->index->rd_id,
-						PGrnScanOpaqueResolveID(so));
-				continue;
+				GRN_BULK_REWIND(&(buffers->ctid));
+				grn_obj_get_value(
+					ctx, so->ctidAccessor, so->currentID, &(buffers->ctid));
+				if (GRN_BULK_VSIZE(&(buffers->ctid)) == 0)
+				{
+					GRN_LOG(ctx,
+							GRN_LOG_DEBUG,
+							"%s[nonexistent] <%s>(%u): <%u>",
+							tag,
+							so->index->rd_rel->relname.data,
+							so->index->rd_id,
+							PGrnScanOpaqueResolveID(so));
+					continue;
+				}
+				packedCtid = GRN_UINT64_VALUE(&(buffers->ctid));
 			}
+			else
+			{
+				grn_id sourceID = so->currentID;
 
-			packedCtid = GRN_UINT64_VALUE(&(buffers->ctid));
-			ctid = PGrnCtidUnpack(packedCtid);
-			GRN_LOG(ctx,
-					GRN_LOG_DEBUG,
-					"%s <%s>(%u): <%u>: <(%u,%u),%u>(%" PRIu64 ")",
-					tag,
-					so->index->rd_rel->relname.data,
-					so->index->rd_id,
-					PGrnScanOpaqueResolveID(so),
-					ctid.ip_blkid.bi_hi,
-					ctid.ip_blkid.bi_lo,
-					ctid.ip_posid,
-					packedCtid);
-			if (!ItemPointerIsValid(&ctid))
-				continue;
-			tbm_add_tuples(tbm, &ctid, 1, scan->xs_recheck);
-			nRecords++;
+				if (so->searched)
+				{
+					void *key;
+					grn_table_cursor_get_key(ctx, so->tableCursor, &key);
+					sourceID = *((grn_id *) key);
+				}
+				if (!PGrnGetBitmapGetPackedCtid(
+						so, batch, sourceID, &packedCtid))
+				{
+					GRN_LOG(ctx,
+							GRN_LOG_DEBUG,
+							"%s[nonexistent] <%s>(%u): <%u>",
+							tag,
+							so->index->rd_rel->relname.data,
+							so->index->rd_id,
+							sourceID);
+					continue;
+				}
+			}
+
+			PGrnGetBitmapBatchAdd(batch, packedCtid);
 		}
 	}
 
+	PGrnGetBitmapBatchFlush(batch);
+	GRN_LOG(ctx,
+			GRN_LOG_DEBUG,
+			"%s <%s>(%u): <%" PRId64 ">",
+			tag,
+			so->index->rd_rel->relname.data,
+			so->index->rd_id,
+			(int64_t) batch->nRecords);
+
+	if (batch->sourcesCtidColumnCache)
+		grn_column_cache_close(ctx, batch->sourcesCtidColumnCache);
+	nRecords = batch->nRecords;
+	pfree(batch);
+
 	return nRecords;
 }
 
@@ -7622,6 +8664,8 @@ PGrnBuildCallback(Relation index,
 	recordSize = PGrnInsert(index,
 							bs->sourcesTable,
 							bs->sourcesCtidColumn,
+							NULL,
+							bs->referenceCache,
 							values,
 							isnull,
 							tid,
@@ -7648,6 +8692,12 @@ pgroonga_build_copy_source_execute(PGrnCreateData *data,
 		bs->bulkInsertWALData = PGrnWALStart(data->index);
 		PGrnWALBulkInsertStart(bs->bulkInsertWALData, bs->sourcesTable);
 	}
+	bs->referenceCache = grn_hash_create(ctx,
+										 NULL,
+										 GRN_TABLE_MAX_KEY_SIZE,
+										 sizeof(grn_id),
+										 GRN_OBJ_TABLE_HASH_KEY |
+											 GRN_OBJ_KEY_VAR_SIZE);
 	/* Disable WAL generation while bulk source table creation for
 	 * performance. If PGroonga is crashed while bulk source table
 	 * creation, this source table will be removed in the next
@@ -7676,6 +8726,11 @@ pgroonga_build_copy_source_execute(PGrnCreateData *data,
 		PGrnWALFinish(bs->bulkInsertWALData);
 		bs->bulkInsertWALData = NULL;
 	}
+	if (bs->referenceCache)
+	{
+		grn_hash_close(ctx, bs->referenceCache);
+		bs->referenceCache = NULL;
+	}
 }
 
 static void
@@ -7686,19 +8741,15 @@ pgroonga_build_copy_source_serial(PGrnCreateData *data, PGrnBuildStateData *bs)
 
 #ifdef PGRN_SUPPORT_PARALLEL_INDEX_BUILD
 /*
- * Parallel source copy related feature is unstable. This
- * implementation was slower than serial source copy with some
- * tests.
- *
  * The bottle neck of source copy wasn't serial data read from
  * PostgreSQL and data write to Groonga. The bottle neck of source
  * copy was casting source data to reference values. In casting to
  * reference values, we need to add a record to a Groonga table. It
- * needs a lock. It may be a slow cause. Or grn_obj_cast() related
- * code may be a slow cause.
+ * needs a lock even when the record already exists.
  *
- * So we disable this by default. We may revisit this when we think
- * that this is useful.
+ * Each worker resolves reference values with its own reference cache
+ * (see PGrnCastWithReferenceCache()). Each worker locks the
+ * referenced table only for new keys. So this is enabled by default.
  */
 
 static const char *PGroongaLibraryName = "pgroonga";
@@ -7831,6 +8882,7 @@ pgroonga_build_copy_source_parallel_main(dsm_segment *seg, shm_toc *toc)
 	bs.isBulkInsert = sharedData->isBulkInsert;
 	bs.bulkInsertWALData = NULL;
 	bs.walRoleKeep = grn_ctx_get_wal_role(ctx);
+	bs.referenceCache = NULL;
 	pgroonga_build_copy_source_worker(&localData, sharedData, &bs);
 	MemoryContextDelete(bs.memoryContext);
 
@@ -7990,6 +9042,7 @@ pgroonga_build_copy_source_parallel(PGrnCreateData *data,
 		localBS.isBulkInsert = bs->isBulkInsert;
 		localBS.bulkInsertWALData = NULL;
 		localBS.walRoleKeep = bs->walRoleKeep;
+		localBS.referenceCache = NULL;
 		pgroonga_build_copy_source_worker(&localData, sharedData, &localBS);
 	}
 
@@ -8033,8 +9086,43 @@ pgroonga_build_copy_source_parallel(PGrnCreateData *data,
 typedef struct PGrnProgressState
 {
 	grn_progress_index_phase phase;
+	Relation index;
+	int nThreads;
+	TimestampTz phaseStartTime;
+	uint32_t nPhaseTargets;
 } PGrnProgressState;
 
+static void
+PGrnProgressReportThroughput(PGrnProgressState *state, const char *unit)
+{
+	long elapsedMilliseconds;
+	double elapsed;
+	double throughput;
+	int nThreads = Max(state->nThreads, 1);
+
+	elapsedMilliseconds = TimestampDifferenceMilliseconds(
+		state->phaseStartTime, GetCurrentTimestamp());
+	elapsed = elapsedMilliseconds / 1000.0;
+	if (elapsed > 0)
+		throughput = state->nPhaseTargets / elapsed;
+	else
+		throughput = state->nPhaseTargets;
+	GRN_LOG(ctx,
+			GRN_LOG_INFO,
+			"pgroonga: [build][progress][%s] <%s>(%u): "
+			"<%u> %s in <%.3f>s: "
+			"<%d> threads: <%.1f> %s/s/thread",
+			state->phase == GRN_PROGRESS_INDEX_LOAD ? "load" : "commit",
+			RelationGetRelationName(state->index),
+			RelationGetRelid(state->index),
+			state->nPhaseTargets,
+			unit,
+			elapsed,
+			state->nThreads,
+			throughput / nThreads,
+			unit);
+}
+
 static void
 PGrnProgressCallback(grn_ctx *ctx, grn_progress *progress, void *user_data)
 {
@@ -8047,6 +9135,21 @@ PGrnProgressCallback(grn_ctx *ctx, grn_progress *progress, void *user_data)
 	}
 
 	phase = grn_progress_index_get_phase(ctx, progress);
+	if (phase != state->phase)
+	{
+		switch (state->phase)
+		{
+		case GRN_PROGRESS_INDEX_LOAD:
+			PGrnProgressReportThroughput(state, "records");
+			break;
+		case GRN_PROGRESS_INDEX_COMMIT:
+			PGrnProgressReportThroughput(state, "terms");
+			break;
+		default:
+			break;
+		}
+		state->phaseStartTime = GetCurrentTimestamp();
+	}
 	switch (phase)
 	{
 	case GRN_PROGRESS_INDEX_LOAD:
@@ -8054,6 +9157,7 @@ PGrnProgressCallback(grn_ctx *ctx, grn_progress *progress, void *user_data)
 		{
 			uint32_t n_target_records =
 				grn_progress_index_get_n_target_records(ctx, progress);
+			state->nPhaseTargets = n_target_records;
 			pgstat_progress_update_param(PROGRESS_CREATEIDX_SUBPHASE,
 										 PROGRESS_PGROONGA_PHASE_INDEX_LOAD);
 			pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_TOTAL,
@@ -8071,6 +9175,7 @@ PGrnProgressCallback(grn_ctx *ctx, grn_progress *progress, void *user_data)
 		{
 			uint32_t n_target_terms =
 				grn_progress_index_get_n_target_terms(ctx, progress);
+			state->nPhaseTargets = n_target_terms;
 			pgstat_progress_update_param(PROGRESS_CREATEIDX_SUBPHASE,
 										 PROGRESS_PGROONGA_PHASE_INDEX_COMMIT);
 			pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_TOTAL,
@@ -8093,6 +9198,33 @@ PGrnProgressCallback(grn_ctx *ctx, grn_progress *progress, void *user_data)
 	state->phase = phase;
 }
 
+/*
+ * The number of threads for static index construction. 0 means that
+ * Groonga's default is used.
+ *
+ * pgroonga.build_threads is used for the first priority. It's useful
+ * to control it per session such as a night batch.
+ */
+static int
+PGrnBuildGetNThreads(Relation index, IndexInfo *indexInfo)
+{
+	int nThreads;
+
+	if (PGrnBuildThreads > 0)
+		return PGrnBuildThreads;
+
+	nThreads = PGrnOptionsGetBuildThreads(index);
+	if (nThreads > 0)
+		return nThreads;
+
+	/* All of workers and leader compute in In PostgreSQL but only
+	 * workers compute in Groonga. So we add +1 here. */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		return indexInfo->ii_ParallelWorkers + 1;
+
+	return 0;
+}
+
 static IndexBuildResult *
 pgroonga_build(Relation heap, Relation index, IndexInfo *indexInfo)
 {
@@ -8103,6 +9235,7 @@ pgroonga_build(Relation heap, Relation index, IndexInfo *indexInfo)
 	grn_obj supplementaryTables;
 	grn_obj lexicons;
 	int32_t nWorkersKeep = grn_ctx_get_n_workers(ctx);
+	int nThreads = PGrnBuildGetNThreads(index, indexInfo);
 
 	PGRN_TRACE_LOG_ENTER();
 
@@ -8158,6 +9291,7 @@ pgroonga_build(Relation heap, Relation index, IndexInfo *indexInfo)
 	bs.isBulkInsert =
 		PGrnWALResourceManagerIsOnlyEnabled() && !PGrnIsJSONBIndex(index);
 	bs.walRoleKeep = grn_ctx_get_wal_role(ctx);
+	bs.referenceCache = NULL;
 
 	GRN_PTR_INIT(&supplementaryTables, GRN_OBJ_VECTOR, GRN_ID_NIL);
 	GRN_PTR_INIT(&lexicons, GRN_OBJ_VECTOR, GRN_ID_NIL);
@@ -8166,6 +9300,10 @@ pgroonga_build(Relation heap, Relation index, IndexInfo *indexInfo)
 		PGrnProgressState state = {0};
 
 		state.phase = GRN_PROGRESS_INDEX_INVALID;
+		state.index = index;
+		state.nThreads = nThreads > 0 ? nThreads : nWorkersKeep;
+		state.phaseStartTime = GetCurrentTimestamp();
+		state.nPhaseTargets = 0;
 		data.supplementaryTables = &supplementaryTables;
 		data.lexicons = &lexicons;
 		data.desc = RelationGetDescr(index);
@@ -8185,16 +9323,12 @@ pgroonga_build(Relation heap, Relation index, IndexInfo *indexInfo)
 		pgroonga_build_copy_source_serial(&data, &bs);
 #endif
 
-		if (indexInfo->ii_ParallelWorkers > 0)
-		{
-			/* All of workers and leader compute in In PostgreSQL but
-			 * only workers compute in Groonga. So we add +1 here. */
-			grn_ctx_set_n_workers(ctx, indexInfo->ii_ParallelWorkers + 1);
-		}
+		if (nThreads > 0)
+			grn_ctx_set_n_workers(ctx, nThreads);
 		grn_ctx_set_progress_callback(ctx, PGrnProgressCallback, &state);
 		PGrnSetSources(index, bs.sourcesTable);
 		grn_ctx_set_progress_callback(ctx, NULL, NULL);
-		if (indexInfo->ii_ParallelWorkers > 0)
+		if (nThreads > 0)
 			grn_ctx_set_n_workers(ctx, nWorkersKeep);
 
 		PGrnCreateSourcesTableFinish(&data);
@@ -8204,7 +9338,7 @@ pgroonga_build(Relation heap, Relation index, IndexInfo *indexInfo)
 		size_t i, n;
 
 		/* Ensure restoring the number of workers on error. */
-		if (indexInfo->ii_ParallelWorkers > 0)
+		if (nThreads > 0)
 			grn_ctx_set_n_workers(ctx, nWorkersKeep);
 
 		/* Ensure restoring WAL role on error. */
@@ -8213,6 +9347,8 @@ pgroonga_build(Relation heap, Relation index, IndexInfo *indexInfo)
 
 		if (bs.isBulkInsert)
 			PGrnWALAbort(bs.bulkInsertWALData);
+		if (bs.referenceCache)
+			grn_hash_close(ctx, bs.referenceCache);
 
 		n = GRN_BULK_VSIZE(&lexicons) / sizeof(grn_obj *);
 		for (i = 0; i < n; i++)
@@ -8351,6 +9487,28 @@ PGrnBulkDeleteResult(IndexVacuumInfo *info, grn_obj *sourcesTable)
 	return stats;
 }
 
+/*
+ * The max number of deleted records in a WAL record written by
+ * pgroonga_bulkdelete(). Deleted records are written as one WAL record
+ * per this number of records instead of one WAL record per record.
+ */
+#define PGRN_BULK_DELETE_WAL_BUFFER_SIZE 1024
+
+/*
+ * Records in deletedPackedCtids are already deleted from Groonga. So
+ * writing them to WAL must not be canceled.
+ */
+static void
+PGrnBulkDeleteWriteWAL(Relation index,
+					   grn_obj *sourcesTable,
+					   grn_obj *deletedPackedCtids)
+{
+	HOLD_INTERRUPTS();
+	PGrnWALBulkDelete(index, sourcesTable, deletedPackedCtids);
+	RESUME_INTERRUPTS();
+	GRN_BULK_REWIND(deletedPackedCtids);
+}
+
 static IndexBulkDeleteResult *
 pgroonga_bulkdelete(IndexVacuumInfo *info,
 					IndexBulkDeleteResult *stats,
@@ -8361,6 +9519,7 @@ pgroonga_bulkdelete(IndexVacuumInfo *info,
 	Relation index = info->index;
 	grn_obj *sourcesTable;
 	grn_table_cursor *cursor;
+	grn_obj deletedPackedCtids;
 	double nRemovedTuples;
 
 	PGRN_TRACE_LOG_ENTER();
@@ -8394,6 +9553,8 @@ pgroonga_bulkdelete(IndexVacuumInfo *info,
 		grn_table_cursor_open(ctx, sourcesTable, NULL, 0, NULL, 0, 0, -1, 0);
 	PGrnCheck("%s failed to open cursor", tag);
 
+	GRN_UINT64_INIT(&deletedPackedCtids, GRN_OBJ_VECTOR);
+
 	PG_TRY();
 	{
 		grn_id id;
@@ -8414,6 +9575,14 @@ pgroonga_bulkdelete(IndexVacuumInfo *info,
 			uint64_t packedCtid;
 			ItemPointerData ctid;
 
+			/* Deleted records must be written to WAL before VACUUM
+			 * is canceled. */
+			if (INTERRUPTS_PENDING_CONDITION() &&
+				GRN_BULK_VSIZE(&deletedPackedCtids) > 0)
+			{
+				PGrnBulkDeleteWriteWAL(
+					index, sourcesTable, &deletedPackedCtids);
+			}
 			CHECK_FOR_INTERRUPTS();
 
 			if (sourcesCtidColumn)
@@ -8471,22 +9640,28 @@ pgroonga_bulkdelete(IndexVacuumInfo *info,
 				PGrnJSONBBulkDeleteRecord(&jsonbData);
 
 				grn_table_cursor_delete(ctx, cursor);
-				PGrnWALDelete(index,
-							  sourcesTable,
-							  (const char *) &packedCtid,
-							  sizeof(uint64_t));
+				GRN_UINT64_PUT(ctx, &deletedPackedCtids, packedCtid);
+				if (GRN_BULK_VSIZE(&deletedPackedCtids) / sizeof(uint64_t) >=
+					PGRN_BULK_DELETE_WAL_BUFFER_SIZE)
+				{
+					PGrnBulkDeleteWriteWAL(
+						index, sourcesTable, &deletedPackedCtids);
+				}
 
 				nRemovedTuples += 1;
 			}
 		}
+		PGrnBulkDeleteWriteWAL(index, sourcesTable, &deletedPackedCtids);
 
 		PGrnJSONBBulkDeleteFin(&jsonbData);
 
 		grn_table_cursor_close(ctx, cursor);
+		GRN_OBJ_FIN(ctx, &deletedPackedCtids);
 	}
 	PG_CATCH();
 	{
 		grn_table_cursor_close(ctx, cursor);
+		GRN_OBJ_FIN(ctx, &deletedPackedCtids);
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
@@ -8590,13 +9765,11 @@ PGrnRemoveUnusedTables(void)
 	 *     Groonga object A` not Groonga object B` because Groonga
 	 *     object A` is still open in connection1. This is the
 	 *     problem.
+	 *
+	 * Connection1 closes Groonga object A` here because connection2
+	 * shared the removed ID.
 	 */
-	PGrnUnmapDB();
-
-	if (processSharedData)
-	{
-		processSharedData->lastVacuumTimestamp = GetCurrentTimestamp();
-	}
+	PGrnEnsureLatestDB();
 
 	GRN_UINT32_INIT(&targetRelationFileNodIDs, GRN_OBJ_VECTOR);
 	cursor = grn_table_cursor_open(ctx,
@@ -8633,12 +9806,30 @@ PGrnRemoveUnusedTables(void)
 	{
 		size_t i;
 		size_t n = GRN_UINT32_VECTOR_SIZE(&targetRelationFileNodIDs);
-		for (i = 0; i < n; i++)
+		grn_obj removedIDs;
+
+		GRN_RECORD_INIT(&removedIDs, GRN_OBJ_VECTOR, GRN_ID_NIL);
+		PG_TRY();
 		{
-			Oid relationFileNodeID =
-				GRN_UINT32_VALUE_AT(&targetRelationFileNodIDs, i);
-			PGrnRemoveUnusedTable(NULL, relationFileNodeID);
+			for (i = 0; i < n; i++)
+			{
+				Oid relationFileNodeID =
+					GRN_UINT32_VALUE_AT(&targetRelationFileNodIDs, i);
+				PGrnCollectIndexObjectIDs(relationFileNodeID, &removedIDs);
+				PGrnRemoveUnusedTable(NULL, relationFileNodeID);
+			}
 		}
+		PG_CATCH();
+		{
+			/* Some objects may be removed. */
+			PGrnPublishRemovedObjects(&removedIDs);
+			GRN_OBJ_FIN(ctx, &removedIDs);
+			GRN_OBJ_FIN(ctx, &targetRelationFileNodIDs);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+		PGrnPublishRemovedObjects(&removedIDs);
+		GRN_OBJ_FIN(ctx, &removedIDs);
 	}
 	GRN_OBJ_FIN(ctx, &targetRelationFileNodIDs);
 
@@ -8729,6 +9920,53 @@ pgroonga_canreturn(Relation index, int nthAttribute)
 	return can_return;
 }
 
+/*
+ * Prepares the index for estimation and returns its sources table.
+ * This is also used for PGroongaScan.
+ */
+grn_obj *
+PGrnCostEstimateLookupSourcesTable(Relation index)
+{
+	PGrnEnsureLatestDB();
+	PGrnWALApplyDeferrable(index);
+	return PGrnLookupSourcesTable(index, ERROR);
+}
+
+/*
+ * Estimates the selectivity of the condition in data by Groonga. This
+ * is also used for PGroongaScan.
+ */
+double
+PGrnCostEstimateSelectivity(grn_obj *sourcesTable, PGrnSearchData *data)
+{
+	unsigned int estimatedSize;
+	unsigned int nRecords;
+
+	if (data->isEmptyCondition)
+	{
+		estimatedSize = 0;
+	}
+	else
+	{
+		estimatedSize = grn_expr_estimate_size(ctx, data->expression);
+	}
+
+	nRecords = grn_table_size(ctx, sourcesTable);
+	if (estimatedSize > nRecords)
+		estimatedSize = nRecords * 0.8;
+	if (estimatedSize == nRecords)
+	{
+		/* TODO: estimatedSize == nRecords means
+		 * estimation isn't supported in Groonga. We should
+		 * support it in Groonga. */
+		return PGrnDefaultSelectivity;
+	}
+	else
+	{
+		return (double) estimatedSize / (double) nRecords;
+	}
+}
+
 static void
 PGrnCostEstimateUpdateSelectivityOne(PlannerInfo *root,
 									 IndexPath *path,
@@ -8791,35 +10029,7 @@ PGrnCostEstimateUpdateSelectivityOne(PlannerInfo *root,
 	key.sk_argument = ((Const *) estimatedRightNode)->constvalue;
 	PGrnSearchDataInit(&data, index, sourcesTable);
 	PGrnSearchBuildCondition(index, &key, &data);
-	{
-		unsigned int estimatedSize;
-		unsigned int nRecords;
-
-		if (data.isEmptyCondition)
-		{
-			estimatedSize = 0;
-		}
-		else
-		{
-			estimatedSize = grn_expr_estimate_size(ctx, data.expression);
-		}
-
-		nRecords = grn_table_size(ctx, sourcesTable);
-		if (estimatedSize > nRecords)
-			estimatedSize = nRecords * 0.8;
-		if (estimatedSize == nRecords)
-		{
-			/* TODO: estimatedSize == nRecords means
-			 * estimation isn't supported in Groonga. We should
-			 * support it in Groonga. */
-			info->norm_selec = 0.01;
-		}
-		else
-		{
-			info->norm_selec = (double) estimatedSize / (double) nRecords;
-			/* path->path.rows = (double) estimatedSize; */
-		}
-	}
+	info->norm_selec = PGrnCostEstimateSelectivity(sourcesTable, &data);
 	PGrnSearchDataFree(&data);
 }
 
@@ -8832,8 +10042,7 @@ PGrnCostEstimateUpdateSelectivity(Relation index,
 	List *quals;
 	ListCell *cell;
 
-	PGrnWALApply(index);
-	sourcesTable = PGrnLookupSourcesTable(index, ERROR);
+	sourcesTable = PGrnCostEstimateLookupSourcesTable(index);
 
 	quals = get_quals_from_indexclauses(path->indexclauses);
 	foreach (cell, quals)
@@ -8850,6 +10059,113 @@ PGrnCostEstimateUpdateSelectivity(Relation index,
 	}
 }
 
+/*
+ * Computing disk usage needs stat() for each Groonga object. So the
+ * result is cached in the index cache. It's recomputed after the
+ * relcache of the index is invalidated. For example, VACUUM and
+ * ANALYZE update statistics of the index and invalidate it.
+ */
+static double
+PGrnCostEstimateIndexPages(Relation index, grn_obj *sourcesTable)
+{
+	TupleDesc desc = RelationGetDescr(index);
+	PGrnIndexCacheData *cache;
+	size_t diskUsage;
+	double nIndexPages;
+	unsigned int i;
+
+	cache = PGrnIndexCacheGet(index);
+	if (cache && cache->nIndexPages >= 0)
+		return cache->nIndexPages;
+
+	diskUsage = grn_obj_get_disk_usage(ctx, sourcesTable);
+	for (i = 0; i < desc->natts; i++)
+	{
+		grn_obj *lexicon;
+		grn_obj *indexColumn;
+
+		if (PGrnIsForInclude(index, i))
+			continue;
+
+		lexicon = PGrnLookupLexicon(index, i, PGRN_ERROR_LEVEL_IGNORE);
+		if (lexicon)
+		{
+			diskUsage += grn_obj_get_disk_usage(ctx, lexicon);
+			grn_obj_unlink(ctx, lexicon);
+		}
+		indexColumn = PGrnLookupIndexColumn(index, i, PGRN_ERROR_LEVEL_IGNORE);
+		if (indexColumn)
+		{
+			diskUsage += grn_obj_get_disk_usage(ctx, indexColumn);
+			grn_obj_unlink(ctx, indexColumn);
+		}
+	}
+
+	nIndexPages = ceil((double) diskUsage / BLCKSZ);
+	if (cache)
+		cache->nIndexPages = nIndexPages;
+	return nIndexPages;
+}
+
+/*
+ * Estimates the cost to read Groonga pages to find numIndexTuples
+ * records. loopCount is the number of repeated scans. This is also
+ * used for PGroongaScan.
+ */
+double
+PGrnCostEstimateIOCost(Relation index,
+					   PlannerInfo *root,
+					   grn_obj *sourcesTable,
+					   double numIndexTuples,
+					   double loopCount,
+					   double *indexPages)
+{
+	double nRecords;
+	double numIndexPages;
+	double spcRandomPageCost;
+
+	nRecords = grn_table_size(ctx, sourcesTable);
+	*indexPages = PGrnCostEstimateIndexPages(index, sourcesTable);
+	numIndexPages =
+		ceil(numIndexTuples * *indexPages / Max(nRecords, numIndexTuples));
+
+	get_tablespace_page_costs(
+		index->rd_rel->reltablespace, &spcRandomPageCost, NULL);
+	if (loopCount > 1)
+	{
+		double pagesFetched;
+
+		pagesFetched = index_pages_fetched(numIndexPages * loopCount,
+										   (BlockNumber) *indexPages,
+										   *indexPages,
+										   root);
+		return (pagesFetched * spcRandomPageCost) / loopCount;
+	}
+	else
+	{
+		return numIndexPages * spcRandomPageCost;
+	}
+}
+
+/*
+ * Groonga looks up each search term in the lexicon. The lookup cost
+ * is O(log(the number of terms)). This is also used for PGroongaScan.
+ */
+Cost
+PGrnCostEstimateLexiconLookupCost(Relation index, unsigned int nthAttribute)
+{
+	grn_obj *lexicon;
+	double nTerms = 0.0;
+
+	lexicon = PGrnLookupLexicon(index, nthAttribute, PGRN_ERROR_LEVEL_IGNORE);
+	if (lexicon)
+	{
+		nTerms = grn_table_size(ctx, lexicon);
+		grn_obj_unlink(ctx, lexicon);
+	}
+	return ceil(log2(nTerms + 1.0) + 1.0) * cpu_operator_cost;
+}
+
 static void
 pgroonga_costestimate_internal(Relation index,
 							   PlannerInfo *root,
@@ -8863,16 +10179,38 @@ pgroonga_costestimate_internal(Relation index,
 {
 	List *indexQuals;
 	List *quals;
+	grn_obj *sourcesTable;
+	double nRecords;
+	double numIndexTuples;
+	Cost ioCost;
+	Cost searchCost = 0.0;
+	ListCell *cell;
+
 	PGrnCostEstimateUpdateSelectivity(index, root, path);
 	indexQuals = get_quals_from_indexclauses(path->indexclauses);
 	quals = add_predicate_to_index_quals(path->indexinfo, indexQuals);
 	*indexSelectivity = clauselist_selectivity(
 		root, quals, path->indexinfo->rel->relid, JOIN_INNER, NULL);
 
-	*indexStartupCost = 0.0; /* TODO */
-	*indexTotalCost = 0.0;   /* TODO */
+	sourcesTable = PGrnLookupSourcesTable(index, ERROR);
+	nRecords = grn_table_size(ctx, sourcesTable);
+	numIndexTuples = clamp_row_est(*indexSelectivity * nRecords);
+	ioCost = PGrnCostEstimateIOCost(
+		index, root, sourcesTable, numIndexTuples, loopCount, indexPages);
+
+	foreach (cell, path->indexclauses)
+	{
+		IndexClause *clause = (IndexClause *) lfirst(cell);
+		searchCost +=
+			PGrnCostEstimateLexiconLookupCost(index, clause->indexcol);
+	}
+	/* Groonga processes all matched postings before the first
+	 * tuple is returned. */
+	searchCost += numIndexTuples * PGrnPostingCost;
+
+	*indexStartupCost = ioCost + searchCost;
+	*indexTotalCost = *indexStartupCost + numIndexTuples * cpu_index_tuple_cost;
 	*indexCorrelation = 0.0;
-	*indexPages = 0.0; /* TODO */
 }
 
 static void
@@ -8977,6 +10315,13 @@ pgroonga_initparallelscan(void *target)
 
 	SpinLockInit(&(pgrnParallelScan->mutex));
 	pgrnParallelScan->scanning = false;
+	pgrnParallelScan->searching = false;
+	pgrnParallelScan->published = false;
+	pgrnParallelScan->recordsHandle = DSM_HANDLE_INVALID;
+	pgrnParallelScan->recordsID = 0;
+	pgrnParallelScan->nRecords = 0;
+	pg_atomic_init_u64(&(pgrnParallelScan->nextPosition), 0);
+	ConditionVariableInit(&(pgrnParallelScan->conditionVariable));
 
 	PGRN_TRACE_LOG_EXIT();
 }
@@ -8984,14 +10329,17 @@ pgroonga_initparallelscan(void *target)
 static void
 pgroonga_parallelrescan(IndexScanDesc scan)
 {
-	ParallelIndexScanDesc parallelScan = scan->parallel_scan;
-	PGrnParallelScanDesc pgrnParallelScan =
-		OffsetToPointer((void *) (parallelScan),
-						PGRN_PARALLEL_SCAN_GET_PS_OFFSET_AM(parallelScan));
+	PGrnParallelScanDesc pgrnParallelScan = PGrnParallelScanGetDesc(scan);
 
 	PGRN_TRACE_LOG_ENTER();
 
 	pgrnParallelScan->scanning = false;
+	pgrnParallelScan->searching = false;
+	pgrnParallelScan->published = false;
+	pgrnParallelScan->recordsHandle = DSM_HANDLE_INVALID;
+	pgrnParallelScan->recordsID = 0;
+	pgrnParallelScan->nRecords = 0;
+	pg_atomic_write_u64(&(pgrnParallelScan->nextPosition), 0);
 
 	PGRN_TRACE_LOG_EXIT();
 }
@@ -9000,16 +10348,17 @@ static bool
 PGrnParallelScanAcquire(IndexScanDesc scan)
 {
 	PGrnScanOpaque so = (PGrnScanOpaque) scan->opaque;
-	ParallelIndexScanDesc parallelScan = scan->parallel_scan;
-	PGrnParallelScanDesc pgrnParallelScan =
-		OffsetToPointer((void *) (parallelScan),
-						PGRN_PARALLEL_SCAN_GET_PS_OFFSET_AM(parallelScan));
+	PGrnParallelScanDesc pgrnParallelScan = PGrnParallelScanGetDesc(scan);
 	bool acquired = false;
 
 	if (so->indexCursor)
 		return true;
 	if (so->tableCursor)
 		return true;
+	/* All participants can scan. PGrnParallelScanOpenTableCursor()
+	 * partitions the search result. */
+	if (!PGrnIsRangeSearchable(scan))
+		return true;
 
 	SpinLockAcquire(&(pgrnParallelScan->mutex));
 	if (!pgrnParallelScan->scanning)
@@ -9091,6 +10440,9 @@ pgroonga_handler(PG_FUNCTION_ARGS)
 	routine->amkeytype = InvalidOid;
 
 	routine->aminsert = pgroonga_insert;
+#ifdef PGRN_SUPPORT_AM_INSERT_CLEANUP
+	routine->aminsertcleanup = pgroonga_insertcleanup;
+#endif
 	routine->ambeginscan = pgroonga_beginscan;
 	routine->amgettuple = pgroonga_gettuple;
 	routine->amgetbitmap = pgroonga_getbitmap;
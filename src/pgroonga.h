@@ -7,6 +7,7 @@
 #include <postgres.h>
 
 #include <fmgr.h>
+#include <nodes/pathnodes.h>
 #include <utils/rel.h>
 
 #include "pgrn-compatible.h"
@@ -118,7 +119,20 @@ extern grn_obj PGrnInspectBuffer;
 
 extern bool PGrnGroongaInitialized;
 extern bool PGrnEnableParallelBuildCopy;
+extern int PGrnBuildThreads;
+extern double PGrnPostingCost;
+extern double PGrnDefaultSelectivity;
 void PGrnEnsureDatabase(void);
 void PGrnRemoveUnusedTables(void);
 bool PGrnIndexIsPGroonga(Relation index);
 Datum PGrnConvertToDatum(grn_obj *value, Oid typeID);
+grn_obj *PGrnCostEstimateLookupSourcesTable(Relation index);
+double PGrnCostEstimateSelectivity(grn_obj *sourcesTable, PGrnSearchData *data);
+double PGrnCostEstimateIOCost(Relation index,
+							  PlannerInfo *root,
+							  grn_obj *sourcesTable,
+							  double numIndexTuples,
+							  double loopCount,
+							  double *indexPages);
+Cost PGrnCostEstimateLexiconLookupCost(Relation index,
+										unsigned int nthAttribute);
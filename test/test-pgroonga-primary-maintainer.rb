@@ -30,7 +30,7 @@ class PGroongaPrimaryMaintainerTestCase < Test::Unit::TestCase
     run_sql("CREATE TABLE memos (content text);")
     run_sql("CREATE INDEX memos_content ON memos USING pgroonga (content);")
     run_sql("INSERT INTO memos VALUES ('PGroonga');")
-    200.times do
+    600.times do
       run_sql("INSERT INTO memos VALUES ('PGroonga');")
     end
     run_sql("DELETE FROM memos;")
@@ -515,6 +515,36 @@ SELECT *
                  run_sql_standby("#{select};"))
   end
 
+  test "delete: many records" do
+    run_sql("CREATE TABLE memos (id int, content text);")
+    run_sql("CREATE INDEX memos_content ON memos USING pgroonga (content);")
+    run_sql("INSERT INTO memos " +
+            "SELECT i, 'PGroonga is good! ' || i " +
+            "FROM generate_series(1, 3000) AS i;")
+    run_sql("DELETE FROM memos WHERE id > 500;")
+    run_sql("VACUUM memos;")
+
+    select = <<-SELECT
+SELECT pgroonga_command(
+         'select',
+         ARRAY[
+           'table', pgroonga_table_name('memos_content'),
+           'limit', '0'
+         ]
+       )::jsonb->1->0->0->0 AS n_hits
+    SELECT
+    output = <<-OUTPUT
+#{select};
+ n_hits 
+--------
+ 500
+(1 row)
+
+    OUTPUT
+    assert_equal([output, ""],
+                 run_sql_standby("#{select};"))
+  end
+
   test "truncate: in transaction" do
     run_sql(<<-SQL)
 BEGIN TRANSACTION;
@@ -769,4 +799,90 @@ EXPLAIN (COSTS OFF) #{select};
                  run_sql_standby("#{select};"))
 
   end
+
+  test "multi-row insert" do
+    if @postgresql.version < 17
+      omit("buffered insert is available since PostgreSQL 17")
+    end
+    run_sql("CREATE TABLE memos (content text);")
+    run_sql("CREATE INDEX memos_content ON memos USING pgroonga (content);")
+    run_sql("INSERT INTO memos " +
+            "SELECT 'PGroonga is good! ' || i || ' #{"x" * 512}' " +
+            "FROM generate_series(1, 100) AS i;")
+
+    select = "SELECT count(*) FROM memos WHERE content &@ 'PGroonga'"
+    output = <<-OUTPUT
+#{select};
+ count 
+-------
+   100
+(1 row)
+
+    OUTPUT
+    assert_equal([output, ""],
+                 run_sql_standby("#{select};"))
+  end
+
+  sub_test_case "flush interval" do
+    def additional_standby_configurations
+      <<-CONFIG
+pgroonga_wal_resource_manager.flush_interval = 1h
+pgroonga_wal_resource_manager.log_level = debug
+      CONFIG
+    end
+
+    test "insert and delete" do
+      run_sql("CREATE TABLE memos (id int, content text);")
+      run_sql("CREATE INDEX memos_content ON memos " +
+              "USING pgroonga (content);")
+      run_sql("INSERT INTO memos " +
+              "SELECT i, 'PGroonga is good! ' || i " +
+              "FROM generate_series(1, 100) AS i;")
+      run_sql("DELETE FROM memos WHERE id <= 10;")
+
+      select = "SELECT count(*) FROM memos WHERE content &@ 'PGroonga'"
+      output = <<-OUTPUT
+#{select};
+ count 
+-------
+    90
+(1 row)
+
+      OUTPUT
+      assert_equal([output, ""],
+                   run_sql_standby("#{select};"))
+    end
+
+    test "deferred" do
+      run_sql("CREATE TABLE memos (id int, content text);")
+      run_sql("CREATE INDEX memos_content ON memos " +
+              "USING pgroonga (content);")
+      inserts = 100.times.collect do |i|
+        "INSERT INTO memos VALUES (#{i}, 'PGroonga is good! #{i}');"
+      end
+      run_sql("BEGIN;", *inserts, "COMMIT;")
+
+      pgroonga_log = @postgresql_standby.read_pgroonga_log
+      redo_insert_pattern = /: \[redo\] <INSERT>/
+      flush_pattern = /: flush: <.+?>/
+      n_redo_inserts = pgroonga_log.scan(redo_insert_pattern).size
+      flushes = pgroonga_log.scan(flush_pattern)
+      # Flushes are deferred but all deferred changes are flushed
+      # before redo waits for new WAL.
+      assert_equal([
+                     100,
+                     true,
+                     ": flush: <idle>",
+                     true,
+                   ],
+                   [
+                     n_redo_inserts,
+                     flushes.size < n_redo_inserts,
+                     flushes.last,
+                     pgroonga_log.rindex(flush_pattern) >
+                       pgroonga_log.rindex(redo_insert_pattern),
+                   ],
+                   pgroonga_log)
+    end
+  end
 end
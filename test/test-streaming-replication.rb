@@ -331,8 +331,23 @@ SELECT pgroonga_vacuum();
       1
     end
 
+    def max_parallel_databases
+      1
+    end
+
+    def max_parallel_wal_appliers_per_db
+      0
+    end
+
     def additional_standby_configurations
-      "pgroonga_wal_applier.naptime = #{naptime}"
+      [
+        "pgroonga_wal_applier.naptime = #{naptime}",
+        "pgroonga_wal_applier." +
+        "max_parallel_databases = #{max_parallel_databases}",
+        "pgroonga_wal_applier." +
+        "max_parallel_wal_appliers_per_db = " +
+        "#{max_parallel_wal_appliers_per_db}",
+      ].join("\n")
     end
 
     test "auto apply" do
@@ -384,6 +399,49 @@ SELECT jsonb_pretty(
 
       OUTPUT
     end
+
+    sub_test_case "parallel" do
+      def max_parallel_databases
+        2
+      end
+
+      def max_parallel_wal_appliers_per_db
+        2
+      end
+
+      test "auto apply" do
+        run_sql("CREATE TABLE memos (content text);")
+        run_sql("CREATE INDEX memos_content ON memos " +
+                "USING pgroonga (content);")
+        run_sql("CREATE TABLE tags (name text);")
+        run_sql("CREATE INDEX tags_name ON tags USING pgroonga (name);")
+        run_sql("INSERT INTO memos VALUES ('PGroonga is good!');")
+        run_sql("INSERT INTO tags VALUES ('PGroonga');")
+
+        sleep(naptime * 2)
+
+        sql = <<-SQL
+SELECT pgroonga_command('select',
+                        ARRAY[
+                          'table', pgroonga_table_name('memos_content'),
+                          'output_columns', 'content'
+                        ])::jsonb->1 AS memos,
+       pgroonga_command('select',
+                        ARRAY[
+                          'table', pgroonga_table_name('tags_name'),
+                          'output_columns', 'name'
+                        ])::jsonb->1 AS tags
+        SQL
+        assert_equal([<<-OUTPUT, ""], run_sql_standby(sql))
+#{sql}
+                           memos                           |                     tags                      
+-----------------------------------------------------------+-----------------------------------------------
+ [[[1], [["content", "LongText"]], ["PGroonga is good!"]]] | [[[1], [["name", "LongText"]], ["PGroonga"]]]
+(1 row)
+
+        OUTPUT
+      end
+    end
   end
 
   sub_test_case "pgroonga.max_wal_size" do
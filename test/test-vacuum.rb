@@ -3,7 +3,7 @@ require_relative "helpers/sandbox"
 class VacuumTestCase < Test::Unit::TestCase
   include Helpers::Sandbox
 
-  test "unmap after VACUUM" do
+  test "no unmap after VACUUM without removed objects" do
     run_sql("CREATE TABLE memos (content text);")
     run_sql("CREATE INDEX memos_content ON memos USING pgroonga (content);")
     run_sql("INSERT INTO memos VALUES ('PGroonga is good!');")
@@ -25,11 +25,69 @@ class VacuumTestCase < Test::Unit::TestCase
       input.close
     end
     pgroonga_log = @postgresql.read_pgroonga_log
-    assert_equal(["pgroonga: unmap DB because VACUUM was executed"],
+    assert_equal([],
                  pgroonga_log.scan(/pgroonga: unmap.*$/),
                  pgroonga_log)
   end
 
+  sub_test_case "preloaded" do
+    def shared_preload_libraries
+      ["pgroonga_check", "pgroonga"]
+    end
+
+    test "close only removed objects after REINDEX and VACUUM" do
+      run_sql("CREATE TABLE memos (content text);")
+      run_sql("CREATE INDEX memos_content ON memos USING pgroonga (content);")
+      run_sql("INSERT INTO memos VALUES ('PGroonga is good!');")
+      run_sql("CREATE TABLE tags (name text);")
+      run_sql("CREATE INDEX tags_name ON tags USING pgroonga (name);")
+      run_sql("INSERT INTO tags VALUES ('Groonga');")
+      select_memos = "SELECT * FROM memos WHERE content &@~ 'pgroonga';"
+      select_tags = "SELECT * FROM tags WHERE name &@~ 'groonga';"
+      result = run_sql do |input, output, error|
+        input.puts("SET pgroonga.log_level = debug;")
+        input.puts("SET enable_seqscan = no;")
+        input.puts(select_memos)
+        input.puts(select_tags)
+        2.times do
+          output.each_line do |line|
+            break if line.strip.empty?
+          end
+        end
+        run_sql("SET pgroonga.log_level = debug;",
+                "REINDEX INDEX memos_content;",
+                "VACUUM memos;")
+        input.puts(select_memos)
+        input.puts(select_tags)
+        input.close
+      end
+      assert_equal([<<-OUTPUT, ""], result)
+#{select_memos}
+      content      
+-------------------
+ PGroonga is good!
+(1 row)
+
+#{select_tags}
+  name   
+---------
+ Groonga
+(1 row)
+
+      OUTPUT
+      pgroonga_log = @postgresql.read_pgroonga_log
+      assert_equal([
+                     [],
+                     true,
+                   ],
+                   [
+                     pgroonga_log.scan(/pgroonga: unmap.*$/),
+                     pgroonga_log.include?("pgroonga: close removed object:"),
+                   ],
+                   pgroonga_log)
+    end
+  end
+
   test "broken object" do
     run_sql("CREATE TABLE memos (content text);")
     run_sql("CREATE INDEX memos_content ON memos USING pgroonga (content);")